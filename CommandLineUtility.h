@@ -4,7 +4,10 @@
 #include <iostream>
 #include <iomanip>
 #include <functional>
+#include <sstream>
+#include <stdexcept>
 #include <string_view>
+#include <vector>
 
 namespace CommandLineUtility
 {
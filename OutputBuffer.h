@@ -0,0 +1,120 @@
+#ifndef MEMANALYZER_OUTPUTBUFFER_H
+#define MEMANALYZER_OUTPUTBUFFER_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace CommandLineUtility
+{
+
+    // Formats text into a large block with std::to_chars and hands it to the stream in one write per block (and when
+    // flushed or destroyed), so listing millions of addresses costs little more than copying their digits.
+    class OutputBuffer
+    {
+        static constexpr std::size_t block_size = 1024 * 1024;
+        static constexpr std::size_t max_number_size = 64; // longest number to_chars writes (a double), with room to spare.
+
+        std::ostream& out;
+        std::vector<char> buffer;
+        std::size_t used = 0;
+
+        char* reserve(std::size_t size)
+        {
+            if (used + size > buffer.size())
+            {
+                flush();
+                if (size > buffer.size())
+                    buffer.resize(size);
+            }
+            return buffer.data() + used;
+        }
+
+    public:
+
+        explicit OutputBuffer(std::ostream& out)
+            :   out(out), buffer(block_size)
+        {}
+
+        OutputBuffer(const OutputBuffer& copy) = delete;
+        OutputBuffer& operator=(const OutputBuffer& copy) = delete;
+
+        ~OutputBuffer()
+        {
+            flush();
+        }
+
+        void flush()
+        {
+            out.write(buffer.data(), static_cast<std::streamsize>(used));
+            used = 0;
+        }
+
+        OutputBuffer& put(char c)
+        {
+            *reserve(1) = c;
+            ++used;
+            return *this;
+        }
+
+        OutputBuffer& write(std::string_view str)
+        {
+            char* dest = reserve(str.size());
+            std::copy(str.begin(), str.end(), dest);
+            used += str.size();
+            return *this;
+        }
+
+        // Decimal for integers (8 bit ones as numbers, not characters), shortest round trip form for floats.
+        template <typename T>
+        OutputBuffer& number(T num)
+        {
+            char* dest = reserve(max_number_size);
+            if constexpr (std::is_integral_v<T> and sizeof(T) == 1)
+                used = std::to_chars(dest, dest + max_number_size, static_cast<int>(num)).ptr - buffer.data();
+            else
+                used = std::to_chars(dest, dest + max_number_size, num).ptr - buffer.data();
+            return *this;
+        }
+
+        // 0x prefixed lowercase hex of the integer's bits, like print_hex.
+        template <typename T>
+        OutputBuffer& hex(T num)
+        {
+            static_assert(std::is_integral_v<T>, "Num must be an integer.");
+
+            char* dest = reserve(max_number_size);
+            dest[0] = '0';
+            dest[1] = 'x';
+            const auto bits = static_cast<std::uint64_t>(static_cast<std::make_unsigned_t<T>>(num));
+            used = std::to_chars(dest + 2, dest + max_number_size, bits, 16).ptr - buffer.data();
+            return *this;
+        }
+
+        // The bytes of a trivially copyable value, in the host's byte order.
+        template <typename T>
+        OutputBuffer& raw(const T& val)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            return write({ reinterpret_cast<const char*>(&val), sizeof val });
+        }
+
+        OutputBuffer& operator<<(std::string_view str)
+        {
+            return write(str);
+        }
+
+        OutputBuffer& operator<<(char c)
+        {
+            return put(c);
+        }
+    };
+
+}
+
+#endif //MEMANALYZER_OUTPUTBUFFER_H
@@ -1,9 +1,8 @@
 #ifndef SCANNER_ADDRESSRANGE_H
 #define SCANNER_ADDRESSRANGE_H
 
-#include <windows.h>
-#include <vector>
 #include <cstdint>
+#include <cstddef>
 
 class AddressRange
 {
@@ -0,0 +1,439 @@
+#ifndef SCANNER_ASYNCREADER_H
+#define SCANNER_ASYNCREADER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// Reads of a process's memory kept in flight while the caller works on earlier ones, so a scan thread compares one
+// window while the next ones are being read. A reader serves one thread at a time. Reads are grouped by a small tag
+// (a buffer slot): wait(tag) returns once every read submitted under it has finished.
+class AsyncReader
+{
+public:
+
+    struct Read
+    {
+        std::byte* buffer;
+        std::uintptr_t address;
+        std::size_t size;
+    };
+
+    virtual ~AsyncReader() = default;
+
+    // Starts all reads; their buffers must stay untouched until wait(tag) returns.
+    virtual void submit(std::size_t tag, std::span<const Read> reads) = 0;
+
+    // Blocks until the reads submitted under 'tag' are done. Returns whether every byte of all of them was read.
+    virtual bool wait(std::size_t tag) = 0;
+
+    // Blocks until no read is in flight and forgets every tag's state, e.g. before giving up buffers after an error.
+    virtual void drain() = 0;
+
+protected:
+
+    // Outstanding reads and failures per tag.
+    struct TagState
+    {
+        std::size_t pending = 0;
+        bool failed = false;
+    };
+
+    std::vector<TagState> tags;
+
+    TagState& tag_state(std::size_t tag)
+    {
+        if (tag >= tags.size())
+            tags.resize(tag + 1);
+        return tags[tag];
+    }
+
+    // Returns whether the tag's reads all succeeded and resets it for reuse.
+    bool finish_tag(std::size_t tag)
+    {
+        TagState& state = tag_state(tag);
+        const bool ok = !state.failed;
+        state.failed = false;
+        return ok;
+    }
+};
+
+#ifndef _WIN32
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// An open file descriptor, closed on destruction.
+class FileDescriptor
+{
+    int fd = -1;
+
+public:
+
+    explicit FileDescriptor(int fd)
+        :   fd(fd)
+    {}
+
+    FileDescriptor(const FileDescriptor& copy) = delete;
+    FileDescriptor& operator=(const FileDescriptor& copy) = delete;
+
+    ~FileDescriptor()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    int get() const { return fd; }
+};
+
+// Reads /proc/<pid>/mem through an io_uring. The kernel hands the reads to its own worker threads, so they proceed
+// while the submitting thread computes. Talks to the ring through the raw system calls (no liburing).
+class UringReader final : public AsyncReader
+{
+    static constexpr unsigned ring_entries = 64;
+
+    // A read the kernel has not completed yet; its index is the submission's user_data.
+    struct InFlight
+    {
+        std::size_t tag;
+        std::size_t size;
+    };
+
+    FileDescriptor mem;
+    io_uring_params params {};
+    FileDescriptor ring;
+    void* ring_map = MAP_FAILED; // both queues' rings (IORING_FEAT_SINGLE_MMAP).
+    void* sqe_map = MAP_FAILED;
+    std::size_t ring_map_size = 0;
+    std::size_t sqe_map_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned sq_mask = 0;
+    unsigned* sq_array = nullptr;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    std::vector<InFlight> in_flight { ring_entries };
+    std::vector<unsigned> free_reads; // indices into in_flight that are not in use.
+    unsigned queued = 0; // in the submission queue, not yet passed to the kernel.
+
+    static unsigned load_acquire(unsigned* value)
+    {
+        return std::atomic_ref<unsigned>{ *value }.load(std::memory_order_acquire);
+    }
+
+    static void store_release(unsigned* value, unsigned new_value)
+    {
+        std::atomic_ref<unsigned>{ *value }.store(new_value, std::memory_order_release);
+    }
+
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+        int result;
+        do
+        {
+            result = static_cast<int>(syscall(__NR_io_uring_enter, ring.get(), to_submit, min_complete, flags, nullptr, 0));
+        }
+        while (result < 0 and errno == EINTR);
+        return result;
+    }
+
+    // Passes the queued submissions to the kernel.
+    void flush()
+    {
+        while (queued > 0)
+        {
+            const int submitted = enter(queued, 0, 0);
+            if (submitted <= 0)
+                throw std::runtime_error("Could not submit reads.");
+            queued -= static_cast<unsigned>(submitted);
+        }
+    }
+
+    // Records every available completion.
+    void reap()
+    {
+        unsigned head = *cq_head;
+        const unsigned tail = load_acquire(cq_tail);
+        for (; head != tail; ++head)
+        {
+            const io_uring_cqe& cqe = cqes[head & cq_mask];
+            const auto read_index = static_cast<unsigned>(cqe.user_data);
+            const InFlight& read = in_flight[read_index];
+            // A short read stopped at an unreadable page.
+            TagState& state = tag_state(read.tag);
+            if (cqe.res < 0 or static_cast<std::size_t>(cqe.res) != read.size)
+                state.failed = true;
+            --state.pending;
+            free_reads.push_back(read_index);
+        }
+        store_release(cq_head, head);
+    }
+
+    // Blocks until at least one more read completes.
+    void wait_one()
+    {
+        flush();
+        if (enter(0, 1, IORING_ENTER_GETEVENTS) < 0)
+            throw std::runtime_error("Could not wait for reads.");
+        reap();
+    }
+
+    void unmap()
+    {
+        if (sqe_map != MAP_FAILED)
+            munmap(sqe_map, sqe_map_size);
+        if (ring_map != MAP_FAILED)
+            munmap(ring_map, ring_map_size);
+    }
+
+public:
+
+    // Takes ownership of mem_fd. Throws if io_uring is unavailable.
+    explicit UringReader(int mem_fd)
+        :   mem(mem_fd), ring(static_cast<int>(syscall(__NR_io_uring_setup, ring_entries, &params)))
+    {
+        if (ring.get() < 0 or !(params.features & IORING_FEAT_SINGLE_MMAP))
+            throw std::runtime_error("io_uring is not available.");
+
+        ring_map_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned), params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        ring_map = mmap(nullptr, ring_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.get(), IORING_OFF_SQ_RING);
+        sqe_map_size = params.sq_entries * sizeof(io_uring_sqe);
+        sqe_map = mmap(nullptr, sqe_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring.get(), IORING_OFF_SQES);
+        if (ring_map == MAP_FAILED or sqe_map == MAP_FAILED)
+        {
+            unmap();
+            throw std::runtime_error("io_uring is not available.");
+        }
+
+        auto* rings = static_cast<char*>(ring_map);
+        sq_tail = reinterpret_cast<unsigned*>(rings + params.sq_off.tail);
+        sq_mask = *reinterpret_cast<unsigned*>(rings + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(rings + params.sq_off.array);
+        sqes = static_cast<io_uring_sqe*>(sqe_map);
+
+        cq_head = reinterpret_cast<unsigned*>(rings + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(rings + params.cq_off.tail);
+        cq_mask = *reinterpret_cast<unsigned*>(rings + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(rings + params.cq_off.cqes);
+
+        for (unsigned i = ring_entries; i > 0; --i)
+        {
+            free_reads.push_back(i - 1);
+        }
+    }
+
+    UringReader(const UringReader& copy) = delete;
+    UringReader& operator=(const UringReader& copy) = delete;
+
+    ~UringReader() override
+    {
+        try
+        {
+            drain();
+        }
+        catch (const std::runtime_error&)
+        {
+        }
+        unmap();
+    }
+
+    void submit(std::size_t tag, std::span<const Read> reads) override
+    {
+        for (const Read& read : reads)
+        {
+            // At most ring_entries reads are in flight, so neither queue of the ring can overflow.
+            while (free_reads.empty())
+                wait_one();
+
+            const unsigned read_index = free_reads.back();
+            free_reads.pop_back();
+            in_flight[read_index] = { tag, read.size };
+            ++tag_state(tag).pending;
+
+            const unsigned tail = *sq_tail;
+            const unsigned index = tail & sq_mask;
+            io_uring_sqe& sqe = sqes[index];
+            sqe = {};
+            sqe.opcode = IORING_OP_READ;
+            sqe.fd = mem.get();
+            sqe.addr = reinterpret_cast<std::uint64_t>(read.buffer);
+            sqe.len = static_cast<std::uint32_t>(read.size);
+            sqe.off = read.address;
+            sqe.user_data = read_index;
+            sq_array[index] = index;
+            store_release(sq_tail, tail + 1);
+            ++queued;
+        }
+        flush();
+    }
+
+    bool wait(std::size_t tag) override
+    {
+        while (tag_state(tag).pending > 0)
+        {
+            reap();
+            if (tag_state(tag).pending > 0)
+                wait_one();
+        }
+        return finish_tag(tag);
+    }
+
+    void drain() override
+    {
+        while (free_reads.size() < ring_entries)
+        {
+            reap();
+            if (free_reads.size() < ring_entries)
+                wait_one();
+        }
+        tags.clear();
+    }
+};
+
+// Reads /proc/<pid>/mem with pread on a helper thread, for kernels without io_uring (or with it disabled).
+// One helper per reader: the scan threads' readers together form the pool of threads doing the reads.
+class PreadReader final : public AsyncReader
+{
+    struct Job
+    {
+        std::size_t tag;
+        Read read;
+    };
+
+    FileDescriptor mem;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Job> jobs;
+    bool stopping = false;
+    std::thread helper;
+
+    bool read_fully(const Read& read) const
+    {
+        std::size_t done = 0;
+        while (done < read.size)
+        {
+            const ssize_t result = pread(mem.get(), read.buffer + done, read.size - done, static_cast<off_t>(read.address + done));
+            if (result < 0 and errno == EINTR)
+                continue;
+            if (result <= 0)
+                return false;
+            done += static_cast<std::size_t>(result);
+        }
+        return true;
+    }
+
+    void helper_loop()
+    {
+        std::unique_lock lock { mutex };
+        while (true)
+        {
+            changed.wait(lock, [this]{ return stopping or !jobs.empty(); });
+            if (jobs.empty())
+                return;
+
+            const Job job = jobs.front();
+            jobs.pop_front();
+            lock.unlock();
+            const bool ok = read_fully(job.read);
+            lock.lock();
+
+            TagState& state = tag_state(job.tag);
+            state.failed = state.failed or !ok;
+            --state.pending;
+            changed.notify_all();
+        }
+    }
+
+public:
+
+    explicit PreadReader(int mem_fd)
+        :   mem(mem_fd), helper(&PreadReader::helper_loop, this)
+    {}
+
+    PreadReader(const PreadReader& copy) = delete;
+    PreadReader& operator=(const PreadReader& copy) = delete;
+
+    ~PreadReader() override
+    {
+        {
+            // The helper finishes the reads still queued before it exits.
+            std::scoped_lock lock { mutex };
+            stopping = true;
+        }
+        changed.notify_all();
+        helper.join();
+    }
+
+    void submit(std::size_t tag, std::span<const Read> reads) override
+    {
+        {
+            std::scoped_lock lock { mutex };
+            tag_state(tag).pending += reads.size();
+            for (const Read& read : reads)
+            {
+                jobs.push_back({ tag, read });
+            }
+        }
+        changed.notify_all();
+    }
+
+    bool wait(std::size_t tag) override
+    {
+        std::unique_lock lock { mutex };
+        changed.wait(lock, [&]{ return tag_state(tag).pending == 0; });
+        return finish_tag(tag);
+    }
+
+    void drain() override
+    {
+        std::unique_lock lock { mutex };
+        changed.wait(lock, [this]{ return std::all_of(tags.begin(), tags.end(), [](const TagState& state){ return state.pending == 0; }); });
+        tags.clear();
+    }
+};
+
+// A reader of the memory of process 'pid': io_uring where the kernel allows it, else pread on a helper thread.
+// Null if /proc/<pid>/mem cannot be opened.
+inline std::unique_ptr<AsyncReader> open_process_reader(unsigned long pid)
+{
+    const std::string path = "/proc/" + std::to_string(pid) + "/mem";
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+
+    try
+    {
+        return std::make_unique<UringReader>(fd);
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+
+    // The failed UringReader closed its descriptor.
+    const int pread_fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (pread_fd < 0)
+        return nullptr;
+    return std::make_unique<PreadReader>(pread_fd);
+}
+
+#endif
+
+#endif //SCANNER_ASYNCREADER_H
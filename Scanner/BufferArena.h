@@ -0,0 +1,105 @@
+#ifndef SCANNER_BUFFERARENA_H
+#define SCANNER_BUFFERARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// Pool of page aligned read buffers reused across scan windows, so a scan allocates at most one buffer per thread
+// no matter how large the regions are.
+class BufferArena
+{
+public:
+
+    static constexpr std::size_t alignment = 4096;
+
+private:
+
+    struct AlignedDelete
+    {
+        void operator()(std::byte* ptr) const
+        {
+            ::operator delete[](ptr, std::align_val_t{ alignment });
+        }
+    };
+
+    using Buffer = std::unique_ptr<std::byte[], AlignedDelete>;
+
+    struct Cached
+    {
+        Buffer buffer;
+        std::size_t size;
+    };
+
+    std::mutex mutex;
+    std::vector<Cached> free_buffers;
+
+    Cached allocate(std::size_t size)
+    {
+        size = (size + alignment - 1) / alignment * alignment;
+        return { Buffer{ static_cast<std::byte*>(::operator new[](size, std::align_val_t{ alignment })) }, size };
+    }
+
+    void release(Cached cached)
+    {
+        std::scoped_lock lock { mutex };
+        free_buffers.emplace_back(std::move(cached));
+    }
+
+public:
+
+    // A buffer on loan from the arena, returned to it on destruction.
+    class Lease
+    {
+        BufferArena* arena;
+        Cached cached;
+
+    public:
+
+        Lease(BufferArena& arena, Cached cached)
+            :   arena(&arena), cached(std::move(cached))
+        {}
+
+        Lease(const Lease& copy) = delete;
+        Lease& operator=(const Lease& copy) = delete;
+
+        ~Lease()
+        {
+            arena->release(std::move(cached));
+        }
+
+        std::byte* data() const { return cached.buffer.get(); }
+        std::size_t size() const { return cached.size; }
+    };
+
+    // Returns a cached buffer of at least 'size' bytes or allocates a new one.
+    // Cached buffers that are too small for the request are freed.
+    Lease acquire(std::size_t size)
+    {
+        {
+            std::scoped_lock lock { mutex };
+            while (!free_buffers.empty())
+            {
+                Cached cached = std::move(free_buffers.back());
+                free_buffers.pop_back();
+                if (cached.size >= size)
+                {
+                    return { *this, std::move(cached) };
+                }
+            }
+        }
+
+        return { *this, allocate(size) };
+    }
+
+    // Frees every buffer not currently on loan.
+    void trim()
+    {
+        std::scoped_lock lock { mutex };
+        free_buffers.clear();
+    }
+};
+
+#endif //SCANNER_BUFFERARENA_H
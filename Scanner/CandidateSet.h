@@ -0,0 +1,345 @@
+#ifndef SCANNER_CANDIDATESET_H
+#define SCANNER_CANDIDATESET_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <vector>
+
+// Sorted offsets of a where chain, stored per block (one scan window of a region) in whichever encoding is smallest:
+// - whole: every slot of the block is a candidate, nothing is stored.
+// - bitmap: one bit per slot.
+// - deltas: LEB128 varints of the gaps between consecutive candidate slots.
+// A slot is 'stride' bytes wide (the scanned type's size), so an offset is start + slot * stride.
+class CandidateSet
+{
+public:
+
+    enum class Encoding : std::uint8_t
+    {
+        whole,
+        bitmap,
+        deltas,
+    };
+
+    struct Block
+    {
+        std::uintptr_t start;
+        std::uint32_t slots;
+        std::uint32_t count;
+        Encoding encoding;
+        std::size_t data_offset; // into the shared encoded data.
+
+        std::uintptr_t end(std::uint32_t stride) const { return start + static_cast<std::uintptr_t>(slots) * stride; }
+    };
+
+private:
+
+    std::uint32_t stride = 1;
+    std::vector<Block> blocks;
+    std::vector<std::uint8_t> data;
+    std::size_t total = 0;
+
+    static void write_varint(std::vector<std::uint8_t>& out, std::uint64_t val)
+    {
+        while (val >= 0x80)
+        {
+            out.push_back(static_cast<std::uint8_t>(val | 0x80));
+            val >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(val));
+    }
+
+    static std::uint64_t read_varint(const std::uint8_t* bytes, std::size_t& pos)
+    {
+        std::uint64_t val = 0;
+        int shift = 0;
+        std::uint8_t byte;
+        do
+        {
+            byte = bytes[pos++];
+            val |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return val;
+    }
+
+    static std::size_t varint_size(std::uint64_t val)
+    {
+        std::size_t size = 1;
+        while (val >= 0x80)
+        {
+            val >>= 7;
+            ++size;
+        }
+        return size;
+    }
+
+public:
+
+    class const_iterator
+    {
+        const CandidateSet* set = nullptr;
+        std::size_t block = 0;
+        std::uint64_t slot = 0;
+        std::size_t pos = 0; // bitmap: next bit to look at, deltas: next varint byte.
+        std::uint32_t left = 0; // candidates of the current block not yet visited, including the current one.
+
+        void find_next_bit()
+        {
+            const std::uint8_t* bitmap = set->data.data() + set->blocks[block].data_offset;
+            while (true)
+            {
+                std::uint8_t bits = bitmap[pos / 8] >> (pos % 8);
+                if (bits)
+                {
+                    pos += std::countr_zero(bits);
+                    slot = pos++;
+                    return;
+                }
+                pos = (pos / 8 + 1) * 8;
+            }
+        }
+
+        void enter_block()
+        {
+            if (block == set->blocks.size())
+                return;
+
+            const Block& b = set->blocks[block];
+            left = b.count;
+            pos = 0;
+            switch (b.encoding)
+            {
+                case Encoding::whole: slot = 0; break;
+                case Encoding::bitmap: find_next_bit(); break;
+                case Encoding::deltas: pos = b.data_offset; slot = read_varint(set->data.data(), pos); break;
+            }
+        }
+
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::uintptr_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::uintptr_t*;
+        using reference = std::uintptr_t;
+
+        const_iterator() = default;
+
+        const_iterator(const CandidateSet& set, std::size_t block)
+            :   set(&set), block(block)
+        {
+            enter_block();
+        }
+
+        std::uintptr_t operator*() const
+        {
+            return set->blocks[block].start + slot * set->stride;
+        }
+
+        const_iterator& operator++()
+        {
+            if (--left == 0)
+            {
+                ++block;
+                enter_block();
+                return *this;
+            }
+
+            switch (set->blocks[block].encoding)
+            {
+                case Encoding::whole: ++slot; break;
+                case Encoding::bitmap: find_next_bit(); break;
+                case Encoding::deltas: slot += read_varint(set->data.data(), pos); break;
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        bool operator==(const const_iterator& other) const
+        {
+            return block == other.block and (block == set->blocks.size() or (slot == other.slot and left == other.left));
+        }
+    };
+
+    CandidateSet() = default;
+
+    explicit CandidateSet(std::uint32_t stride)
+        :   stride(stride)
+    {}
+
+    // Appends a block covering [start, start + slots * stride) holding the given sorted offsets, which must lie in it
+    // at slot boundaries. Picks the smallest encoding. Empty blocks are not stored.
+    void append_block(std::uintptr_t start, std::uint32_t slots, std::span<const std::uintptr_t> offsets)
+    {
+        if (offsets.empty())
+            return;
+
+        Block block { start, slots, static_cast<std::uint32_t>(offsets.size()), Encoding::whole, data.size() };
+        total += offsets.size();
+
+        if (offsets.size() == slots)
+        {
+            blocks.push_back(block);
+            return;
+        }
+
+        std::size_t delta_bytes = 0;
+        std::uint64_t prev_slot = 0;
+        for (std::uintptr_t offset : offsets)
+        {
+            std::uint64_t slot = (offset - start) / stride;
+            delta_bytes += varint_size(slot - prev_slot);
+            prev_slot = slot;
+        }
+
+        const std::size_t bitmap_bytes = (static_cast<std::size_t>(slots) + 7) / 8;
+        if (bitmap_bytes <= delta_bytes)
+        {
+            block.encoding = Encoding::bitmap;
+            data.resize(data.size() + bitmap_bytes, 0);
+            std::uint8_t* bitmap = data.data() + block.data_offset;
+            for (std::uintptr_t offset : offsets)
+            {
+                std::uint64_t slot = (offset - start) / stride;
+                bitmap[slot / 8] |= static_cast<std::uint8_t>(1u << (slot % 8));
+            }
+        }
+        else
+        {
+            block.encoding = Encoding::deltas;
+            prev_slot = 0;
+            for (std::uintptr_t offset : offsets)
+            {
+                std::uint64_t slot = (offset - start) / stride;
+                write_varint(data, slot - prev_slot);
+                prev_slot = slot;
+            }
+        }
+
+        blocks.push_back(block);
+    }
+
+    // Appends a block in which every slot is a candidate.
+    void append_whole_block(std::uintptr_t start, std::uint32_t slots)
+    {
+        if (slots == 0)
+            return;
+
+        blocks.push_back({ start, slots, slots, Encoding::whole, data.size() });
+        total += slots;
+    }
+
+    // Appends every block of another set with the same stride, keeping order.
+    void append(const CandidateSet& other)
+    {
+        const std::size_t data_base = data.size();
+        data.insert(data.end(), other.data.begin(), other.data.end());
+        for (Block block : other.blocks)
+        {
+            block.data_offset += data_base;
+            blocks.push_back(block);
+        }
+        total += other.total;
+    }
+
+    // Appends the offsets of block 'index' to out.
+    void decode_block(std::size_t index, std::vector<std::uintptr_t>& out) const
+    {
+        const Block& block = blocks[index];
+        out.reserve(out.size() + block.count);
+        switch (block.encoding)
+        {
+            case Encoding::whole:
+                for (std::uint64_t slot = 0; slot < block.slots; ++slot)
+                    out.push_back(block.start + slot * stride);
+                break;
+            case Encoding::bitmap:
+            {
+                const std::uint8_t* bitmap = data.data() + block.data_offset;
+                for (std::size_t byte = 0; byte < (static_cast<std::size_t>(block.slots) + 7) / 8; ++byte)
+                {
+                    for (std::uint8_t bits = bitmap[byte]; bits; bits &= bits - 1)
+                        out.push_back(block.start + (byte * 8 + std::countr_zero(bits)) * stride);
+                }
+                break;
+            }
+            case Encoding::deltas:
+            {
+                std::size_t pos = block.data_offset;
+                std::uint64_t slot = 0;
+                for (std::uint32_t i = 0; i < block.count; ++i)
+                {
+                    slot += read_varint(data.data(), pos);
+                    out.push_back(block.start + slot * stride);
+                }
+                break;
+            }
+        }
+    }
+
+    std::span<const Block> get_blocks() const
+    {
+        return blocks;
+    }
+
+    std::uint32_t get_stride() const
+    {
+        return stride;
+    }
+
+    std::size_t size() const
+    {
+        return total;
+    }
+
+    bool empty() const
+    {
+        return total == 0;
+    }
+
+    // Heap bytes used by the encoded set.
+    std::size_t memory_usage() const
+    {
+        return blocks.capacity() * sizeof(Block) + data.capacity();
+    }
+
+    void clear()
+    {
+        blocks.clear();
+        data.clear();
+        total = 0;
+    }
+
+    std::vector<std::uintptr_t> to_vector() const
+    {
+        std::vector<std::uintptr_t> offsets;
+        offsets.reserve(total);
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            decode_block(i, offsets);
+        }
+        return offsets;
+    }
+
+    const_iterator begin() const
+    {
+        return { *this, 0 };
+    }
+
+    const_iterator end() const
+    {
+        return { *this, blocks.size() };
+    }
+};
+
+#endif //SCANNER_CANDIDATESET_H
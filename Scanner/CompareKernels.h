@@ -0,0 +1,647 @@
+#ifndef SCANNER_COMPAREKERNELS_H
+#define SCANNER_COMPAREKERNELS_H
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) or defined(_M_X64) or defined(__i386__) or defined(_M_IX86)
+#define SCANNER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only allow intrinsics of an instruction set inside functions compiled for it.
+// MSVC allows them anywhere, so the attributes expand to nothing there.
+#if defined(SCANNER_X86) and (defined(__GNUC__) or defined(__clang__))
+#define SCANNER_TARGET_SSE2 __attribute__((target("sse2")))
+#define SCANNER_TARGET_AVX2 __attribute__((target("avx2")))
+#define SCANNER_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#else
+#define SCANNER_TARGET_SSE2
+#define SCANNER_TARGET_AVX2
+#define SCANNER_TARGET_AVX512
+#endif
+
+// Vectorized compare loops used by the typed value scans.
+// Each loop compares a whole register of elements at once and turns the resulting match mask into offsets.
+// The instruction set is picked once at runtime from the CPU's features.
+namespace CompareKernels
+{
+
+    enum class Isa
+    {
+        scalar,
+        sse2,
+        avx2,
+        avx512,
+    };
+
+    inline Isa detect_isa()
+    {
+#if defined(SCANNER_X86) and (defined(__GNUC__) or defined(__clang__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512bw"))
+            return Isa::avx512;
+        if (__builtin_cpu_supports("avx2"))
+            return Isa::avx2;
+        if (__builtin_cpu_supports("sse2"))
+            return Isa::sse2;
+#elif defined(SCANNER_X86) and defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 1);
+        const bool sse2 = regs[3] & (1 << 26);
+        const bool os_avx = (regs[2] & (1 << 27)) and (regs[2] & (1 << 28)); // OSXSAVE and AVX.
+        const auto xcr0 = os_avx ? _xgetbv(0) : 0;
+        __cpuidex(regs, 7, 0);
+        const bool avx2 = os_avx and (xcr0 & 0x6) == 0x6 and (regs[1] & (1 << 5));
+        const bool avx512 = avx2 and (xcr0 & 0xe6) == 0xe6 and (regs[1] & (1 << 16)) and (regs[1] & (1 << 30));
+        if (avx512)
+            return Isa::avx512;
+        if (avx2)
+            return Isa::avx2;
+        if (sse2)
+            return Isa::sse2;
+#endif
+        return Isa::scalar;
+    }
+
+    inline Isa active_isa()
+    {
+        static const Isa isa = detect_isa();
+        return isa;
+    }
+
+    inline const char* isa_name(Isa isa)
+    {
+        switch (isa)
+        {
+            case Isa::sse2: return "SSE2";
+            case Isa::avx2: return "AVX2";
+            case Isa::avx512: return "AVX-512";
+            default: return "scalar";
+        }
+    }
+
+    // Tolerance used when comparing floating point values, the scans would otherwise rarely find them.
+    template <typename T>
+    constexpr T float_tolerance = static_cast<T>(0.001);
+
+    template <typename T>
+    bool values_equal(T val1, T val2)
+    {
+        if constexpr(std::is_floating_point_v<T>)
+        {
+            auto dif = std::abs(val1 - val2);
+            return dif <= float_tolerance<T>;
+        }
+        else
+        {
+            return val1 == val2;
+        }
+    }
+
+    // Predicates the scans test values with. Each is its own type, so every kernel below is compiled separately for each
+    // predicate and value type: nothing about the predicate is decided per element at runtime.
+    template <typename T>
+    struct Equal
+    {
+        T val;
+
+        bool operator()(T x) const { return values_equal(x, val); }
+    };
+
+    // lo <= x <= hi. Never true for NaN.
+    template <typename T>
+    struct InRange
+    {
+        T lo;
+        T hi;
+
+        bool operator()(T x) const { return x >= lo and x <= hi; }
+    };
+
+    // The bits of x selected by mask equal val, which has no bits outside mask. Integers only.
+    template <typename T>
+    struct MaskedEqual
+    {
+        T mask;
+        T val;
+
+        bool operator()(T x) const { return static_cast<T>(x & mask) == val; }
+    };
+
+    template <typename P>
+    struct Not
+    {
+        P pred;
+
+        template <typename T>
+        bool operator()(T x) const { return !pred(x); }
+    };
+
+    template <typename P>
+    constexpr bool is_negation = false;
+
+    template <typename P>
+    constexpr bool is_negation<Not<P>> = true;
+
+    // Bits of the lanes of a register of 'bytes' bytes holding T.
+    template <typename T, std::size_t bytes>
+    constexpr std::uint64_t all_lanes = bytes / sizeof(T) == 64 ? ~std::uint64_t{ 0 } : (std::uint64_t{ 1 } << (bytes / sizeof(T))) - 1;
+
+    // Elements may be unaligned (see find_equal_unaligned).
+    template <typename T>
+    T load(const T* element)
+    {
+        T val;
+        std::memcpy(&val, element, sizeof val);
+        return val;
+    }
+
+    // Appends the offset of every set bit of a lane mask. Lane i of the block starting at element 'first' is bit i.
+    template <typename T>
+    inline void append_mask(std::uint64_t mask, std::size_t first, std::uintptr_t first_offset, std::vector<std::uintptr_t>& out)
+    {
+        while (mask)
+        {
+            auto lane = static_cast<std::size_t>(std::countr_zero(mask));
+            out.push_back(first_offset + (first + lane) * sizeof(T));
+            mask &= mask - 1;
+        }
+    }
+
+    // One bit per element of the block of 'lanes' elements that passes 'pred', for compares an instruction set lacks.
+    template <typename T, typename P>
+    std::uint64_t scalar_mask(const T* block, const P& pred, std::size_t lanes)
+    {
+        std::uint64_t mask = 0;
+        for (std::size_t i = 0; i < lanes; ++i)
+        {
+            mask |= static_cast<std::uint64_t>(pred(load(block + i))) << i;
+        }
+        return mask;
+    }
+
+    template <typename T, typename P>
+    void find_matching_scalar(std::span<const T> data, const P& pred, std::size_t first, std::uintptr_t first_offset, std::vector<std::uintptr_t>& out)
+    {
+        for (std::size_t i = first; i < data.size(); ++i)
+        {
+            if (pred(load(data.data() + i)))
+            {
+                out.push_back(first_offset + i * sizeof(T));
+            }
+        }
+    }
+
+#ifdef SCANNER_X86
+
+    // Each instruction set implements a mask function per predicate, returning one bit per T sized lane of a register
+    // sized block that passes it (see all_lanes), and find_matching, the loop over whole registers.
+    struct Sse2
+    {
+        template <typename T>
+        SCANNER_TARGET_SSE2 static __m128i set1(T val)
+        {
+            if constexpr(sizeof(T) == 1)
+                return _mm_set1_epi8(static_cast<char>(val));
+            else if constexpr(sizeof(T) == 2)
+                return _mm_set1_epi16(static_cast<short>(val));
+            else if constexpr(sizeof(T) == 4)
+                return _mm_set1_epi32(static_cast<int>(val));
+            else
+                return _mm_set1_epi64x(static_cast<long long>(val));
+        }
+
+        // Turns a lane wise integer compare result (all ones where true) into a lane mask.
+        template <typename T>
+        SCANNER_TARGET_SSE2 static std::uint64_t lanes_mask(__m128i lanes)
+        {
+            if constexpr(sizeof(T) == 1)
+                return static_cast<std::uint16_t>(_mm_movemask_epi8(lanes));
+            else if constexpr(sizeof(T) == 2)
+                return static_cast<std::uint8_t>(_mm_movemask_epi8(_mm_packs_epi16(lanes, _mm_setzero_si128())));
+            else if constexpr(sizeof(T) == 4)
+                return _mm_movemask_ps(_mm_castsi128_ps(lanes));
+            else
+                return _mm_movemask_pd(_mm_castsi128_pd(lanes));
+        }
+
+        template <typename T>
+        SCANNER_TARGET_SSE2 static __m128i equal_lanes(__m128i a, __m128i b)
+        {
+            if constexpr(sizeof(T) == 1)
+                return _mm_cmpeq_epi8(a, b);
+            else if constexpr(sizeof(T) == 2)
+                return _mm_cmpeq_epi16(a, b);
+            else if constexpr(sizeof(T) == 4)
+                return _mm_cmpeq_epi32(a, b);
+            else
+            {
+                // SSE2 has no 64 bit compare: both 32 bit halves of a lane must be equal.
+                __m128i eq = _mm_cmpeq_epi32(a, b);
+                return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+            }
+        }
+
+        // a > b per lane for 8 to 32 bit T. Unsigned lanes are compared as signed after flipping their top bits.
+        template <typename T>
+        SCANNER_TARGET_SSE2 static __m128i greater_lanes(__m128i a, __m128i b)
+        {
+            if constexpr(std::is_unsigned_v<T>)
+            {
+                const __m128i top = set1<T>(static_cast<T>(T{ 1 } << (8 * sizeof(T) - 1)));
+                a = _mm_xor_si128(a, top);
+                b = _mm_xor_si128(b, top);
+            }
+            if constexpr(sizeof(T) == 1)
+                return _mm_cmpgt_epi8(a, b);
+            else if constexpr(sizeof(T) == 2)
+                return _mm_cmpgt_epi16(a, b);
+            else
+                return _mm_cmpgt_epi32(a, b);
+        }
+
+        // Returns one bit per T sized lane of a 16 byte block that equals 'val' (or is within tolerance for floats).
+        template <typename T>
+        SCANNER_TARGET_SSE2 static std::uint64_t equal_mask(const T* block, T val)
+        {
+            if constexpr(std::is_same_v<T, float>)
+            {
+                const __m128 sign = _mm_set1_ps(-0.0f);
+                __m128 dif = _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(block), _mm_set1_ps(val)));
+                return _mm_movemask_ps(_mm_cmple_ps(dif, _mm_set1_ps(float_tolerance<float>)));
+            }
+            else if constexpr(std::is_same_v<T, double>)
+            {
+                const __m128d sign = _mm_set1_pd(-0.0);
+                __m128d dif = _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(block), _mm_set1_pd(val)));
+                return _mm_movemask_pd(_mm_cmple_pd(dif, _mm_set1_pd(float_tolerance<double>)));
+            }
+            else
+            {
+                const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+                return lanes_mask<T>(equal_lanes<T>(data, set1(val)));
+            }
+        }
+
+        template <typename T>
+        SCANNER_TARGET_SSE2 static std::uint64_t match_mask(const T* block, const Equal<T>& pred)
+        {
+            return equal_mask(block, pred.val);
+        }
+
+        template <typename T>
+        SCANNER_TARGET_SSE2 static std::uint64_t match_mask(const T* block, const InRange<T>& pred)
+        {
+            if constexpr(std::is_same_v<T, float>)
+            {
+                const __m128 data = _mm_loadu_ps(block);
+                return _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(data, _mm_set1_ps(pred.lo)), _mm_cmple_ps(data, _mm_set1_ps(pred.hi))));
+            }
+            else if constexpr(std::is_same_v<T, double>)
+            {
+                const __m128d data = _mm_loadu_pd(block);
+                return _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(data, _mm_set1_pd(pred.lo)), _mm_cmple_pd(data, _mm_set1_pd(pred.hi))));
+            }
+            else if constexpr(sizeof(T) == 8)
+            {
+                // No 64 bit ordered compare before SSE4.2.
+                return scalar_mask(block, pred, 2);
+            }
+            else
+            {
+                const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+                const __m128i outside = _mm_or_si128(greater_lanes<T>(set1(pred.lo), data), greater_lanes<T>(data, set1(pred.hi)));
+                return ~lanes_mask<T>(outside) & all_lanes<T, 16>;
+            }
+        }
+
+        template <typename T>
+        SCANNER_TARGET_SSE2 static std::uint64_t match_mask(const T* block, const MaskedEqual<T>& pred)
+        {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+            return lanes_mask<T>(equal_lanes<T>(_mm_and_si128(data, set1(pred.mask)), set1(pred.val)));
+        }
+
+        template <typename T, typename P>
+        SCANNER_TARGET_SSE2 static std::uint64_t match_mask(const T* block, const Not<P>& pred)
+        {
+            return ~match_mask(block, pred.pred) & all_lanes<T, 16>;
+        }
+
+        template <typename T, typename P>
+        SCANNER_TARGET_SSE2 static void find_matching(std::span<const T> data, const P& pred, std::uintptr_t first_offset, std::vector<std::uintptr_t>& out)
+        {
+            constexpr std::size_t lanes = 16 / sizeof(T);
+            std::size_t i = 0;
+            for (; i + lanes <= data.size(); i += lanes)
+            {
+                append_mask<T>(match_mask(data.data() + i, pred), i, first_offset, out);
+            }
+            find_matching_scalar(data, pred, i, first_offset, out);
+        }
+    };
+
+    struct Avx2
+    {
+        template <typename T>
+        SCANNER_TARGET_AVX2 static __m256i set1(T val)
+        {
+            if constexpr(sizeof(T) == 1)
+                return _mm256_set1_epi8(static_cast<char>(val));
+            else if constexpr(sizeof(T) == 2)
+                return _mm256_set1_epi16(static_cast<short>(val));
+            else if constexpr(sizeof(T) == 4)
+                return _mm256_set1_epi32(static_cast<int>(val));
+            else
+                return _mm256_set1_epi64x(static_cast<long long>(val));
+        }
+
+        template <typename T>
+        SCANNER_TARGET_AVX2 static std::uint64_t lanes_mask(__m256i lanes)
+        {
+            if constexpr(sizeof(T) == 1)
+            {
+                return static_cast<std::uint32_t>(_mm256_movemask_epi8(lanes));
+            }
+            else if constexpr(sizeof(T) == 2)
+            {
+                // packs works per 128 bit lane, so gather the two packed halves into the low lane before taking the mask.
+                __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi16(lanes, lanes), _MM_SHUFFLE(3, 1, 2, 0));
+                return static_cast<std::uint16_t>(_mm_movemask_epi8(_mm256_castsi256_si128(packed)));
+            }
+            else if constexpr(sizeof(T) == 4)
+            {
+                return _mm256_movemask_ps(_mm256_castsi256_ps(lanes));
+            }
+            else
+            {
+                return _mm256_movemask_pd(_mm256_castsi256_pd(lanes));
+            }
+        }
+
+        template <typename T>
+        SCANNER_TARGET_AVX2 static __m256i equal_lanes(__m256i a, __m256i b)
+        {
+            if constexpr(sizeof(T) == 1)
+                return _mm256_cmpeq_epi8(a, b);
+            else if constexpr(sizeof(T) == 2)
+                return _mm256_cmpeq_epi16(a, b);
+            else if constexpr(sizeof(T) == 4)
+                return _mm256_cmpeq_epi32(a, b);
+            else
+                return _mm256_cmpeq_epi64(a, b);
+        }
+
+        template <typename T>
+        SCANNER_TARGET_AVX2 static __m256i greater_lanes(__m256i a, __m256i b)
+        {
+            if constexpr(std::is_unsigned_v<T>)
+            {
+                const __m256i top = set1<T>(static_cast<T>(T{ 1 } << (8 * sizeof(T) - 1)));
+                a = _mm256_xor_si256(a, top);
+                b = _mm256_xor_si256(b, top);
+            }
+            if constexpr(sizeof(T) == 1)
+                return _mm256_cmpgt_epi8(a, b);
+            else if constexpr(sizeof(T) == 2)
+                return _mm256_cmpgt_epi16(a, b);
+            else if constexpr(sizeof(T) == 4)
+                return _mm256_cmpgt_epi32(a, b);
+            else
+                return _mm256_cmpgt_epi64(a, b);
+        }
+
+        template <typename T>
+        SCANNER_TARGET_AVX2 static std::uint64_t equal_mask(const T* block, T val)
+        {
+            if constexpr(std::is_same_v<T, float>)
+            {
+                const __m256 sign = _mm256_set1_ps(-0.0f);
+                __m256 dif = _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(block), _mm256_set1_ps(val)));
+                return _mm256_movemask_ps(_mm256_cmp_ps(dif, _mm256_set1_ps(float_tolerance<float>), _CMP_LE_OQ));
+            }
+            else if constexpr(std::is_same_v<T, double>)
+            {
+                const __m256d sign = _mm256_set1_pd(-0.0);
+                __m256d dif = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(block), _mm256_set1_pd(val)));
+                return _mm256_movemask_pd(_mm256_cmp_pd(dif, _mm256_set1_pd(float_tolerance<double>), _CMP_LE_OQ));
+            }
+            else
+            {
+                const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+                return lanes_mask<T>(equal_lanes<T>(data, set1(val)));
+            }
+        }
+
+        template <typename T>
+        SCANNER_TARGET_AVX2 static std::uint64_t match_mask(const T* block, const Equal<T>& pred)
+        {
+            return equal_mask(block, pred.val);
+        }
+
+        template <typename T>
+        SCANNER_TARGET_AVX2 static std::uint64_t match_mask(const T* block, const InRange<T>& pred)
+        {
+            if constexpr(std::is_same_v<T, float>)
+            {
+                const __m256 data = _mm256_loadu_ps(block);
+                const __m256 inside = _mm256_and_ps(_mm256_cmp_ps(data, _mm256_set1_ps(pred.lo), _CMP_GE_OQ), _mm256_cmp_ps(data, _mm256_set1_ps(pred.hi), _CMP_LE_OQ));
+                return _mm256_movemask_ps(inside);
+            }
+            else if constexpr(std::is_same_v<T, double>)
+            {
+                const __m256d data = _mm256_loadu_pd(block);
+                const __m256d inside = _mm256_and_pd(_mm256_cmp_pd(data, _mm256_set1_pd(pred.lo), _CMP_GE_OQ), _mm256_cmp_pd(data, _mm256_set1_pd(pred.hi), _CMP_LE_OQ));
+                return _mm256_movemask_pd(inside);
+            }
+            else
+            {
+                const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+                const __m256i outside = _mm256_or_si256(greater_lanes<T>(set1(pred.lo), data), greater_lanes<T>(data, set1(pred.hi)));
+                return ~lanes_mask<T>(outside) & all_lanes<T, 32>;
+            }
+        }
+
+        template <typename T>
+        SCANNER_TARGET_AVX2 static std::uint64_t match_mask(const T* block, const MaskedEqual<T>& pred)
+        {
+            const __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+            return lanes_mask<T>(equal_lanes<T>(_mm256_and_si256(data, set1(pred.mask)), set1(pred.val)));
+        }
+
+        template <typename T, typename P>
+        SCANNER_TARGET_AVX2 static std::uint64_t match_mask(const T* block, const Not<P>& pred)
+        {
+            return ~match_mask(block, pred.pred) & all_lanes<T, 32>;
+        }
+
+        template <typename T, typename P>
+        SCANNER_TARGET_AVX2 static void find_matching(std::span<const T> data, const P& pred, std::uintptr_t first_offset, std::vector<std::uintptr_t>& out)
+        {
+            constexpr std::size_t lanes = 32 / sizeof(T);
+            std::size_t i = 0;
+            for (; i + lanes <= data.size(); i += lanes)
+            {
+                append_mask<T>(match_mask(data.data() + i, pred), i, first_offset, out);
+            }
+            find_matching_scalar(data, pred, i, first_offset, out);
+        }
+    };
+
+    struct Avx512
+    {
+        template <typename T>
+        SCANNER_TARGET_AVX512 static __m512i set1(T val)
+        {
+            if constexpr(sizeof(T) == 1)
+                return _mm512_set1_epi8(static_cast<char>(val));
+            else if constexpr(sizeof(T) == 2)
+                return _mm512_set1_epi16(static_cast<short>(val));
+            else if constexpr(sizeof(T) == 4)
+                return _mm512_set1_epi32(static_cast<int>(val));
+            else
+                return _mm512_set1_epi64(static_cast<long long>(val));
+        }
+
+        // AVX-512 compares straight into a lane mask, with a predicate immediate and signed or unsigned variants.
+        template <typename T, int op>
+        SCANNER_TARGET_AVX512 static std::uint64_t compare(__m512i a, __m512i b)
+        {
+            if constexpr(sizeof(T) == 1)
+                return std::is_signed_v<T> ? _mm512_cmp_epi8_mask(a, b, op) : _mm512_cmp_epu8_mask(a, b, op);
+            else if constexpr(sizeof(T) == 2)
+                return std::is_signed_v<T> ? _mm512_cmp_epi16_mask(a, b, op) : _mm512_cmp_epu16_mask(a, b, op);
+            else if constexpr(sizeof(T) == 4)
+                return std::is_signed_v<T> ? _mm512_cmp_epi32_mask(a, b, op) : _mm512_cmp_epu32_mask(a, b, op);
+            else
+                return std::is_signed_v<T> ? _mm512_cmp_epi64_mask(a, b, op) : _mm512_cmp_epu64_mask(a, b, op);
+        }
+
+        template <typename T>
+        SCANNER_TARGET_AVX512 static std::uint64_t equal_mask(const T* block, T val)
+        {
+            if constexpr(std::is_same_v<T, float>)
+            {
+                __m512 dif = _mm512_abs_ps(_mm512_sub_ps(_mm512_loadu_ps(block), _mm512_set1_ps(val)));
+                return _mm512_cmp_ps_mask(dif, _mm512_set1_ps(float_tolerance<float>), _CMP_LE_OQ);
+            }
+            else if constexpr(std::is_same_v<T, double>)
+            {
+                __m512d dif = _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(block), _mm512_set1_pd(val)));
+                return _mm512_cmp_pd_mask(dif, _mm512_set1_pd(float_tolerance<double>), _CMP_LE_OQ);
+            }
+            else
+            {
+                return compare<T, _MM_CMPINT_EQ>(_mm512_loadu_si512(block), set1(val));
+            }
+        }
+
+        template <typename T>
+        SCANNER_TARGET_AVX512 static std::uint64_t match_mask(const T* block, const Equal<T>& pred)
+        {
+            return equal_mask(block, pred.val);
+        }
+
+        template <typename T>
+        SCANNER_TARGET_AVX512 static std::uint64_t match_mask(const T* block, const InRange<T>& pred)
+        {
+            if constexpr(std::is_same_v<T, float>)
+            {
+                const __m512 data = _mm512_loadu_ps(block);
+                return _mm512_cmp_ps_mask(data, _mm512_set1_ps(pred.lo), _CMP_GE_OQ) & _mm512_cmp_ps_mask(data, _mm512_set1_ps(pred.hi), _CMP_LE_OQ);
+            }
+            else if constexpr(std::is_same_v<T, double>)
+            {
+                const __m512d data = _mm512_loadu_pd(block);
+                return _mm512_cmp_pd_mask(data, _mm512_set1_pd(pred.lo), _CMP_GE_OQ) & _mm512_cmp_pd_mask(data, _mm512_set1_pd(pred.hi), _CMP_LE_OQ);
+            }
+            else
+            {
+                const __m512i data = _mm512_loadu_si512(block);
+                return compare<T, _MM_CMPINT_NLT>(data, set1(pred.lo)) & compare<T, _MM_CMPINT_LE>(data, set1(pred.hi));
+            }
+        }
+
+        template <typename T>
+        SCANNER_TARGET_AVX512 static std::uint64_t match_mask(const T* block, const MaskedEqual<T>& pred)
+        {
+            const __m512i data = _mm512_and_si512(_mm512_loadu_si512(block), set1(pred.mask));
+            return compare<T, _MM_CMPINT_EQ>(data, set1(pred.val));
+        }
+
+        template <typename T, typename P>
+        SCANNER_TARGET_AVX512 static std::uint64_t match_mask(const T* block, const Not<P>& pred)
+        {
+            return ~match_mask(block, pred.pred) & all_lanes<T, 64>;
+        }
+
+        template <typename T, typename P>
+        SCANNER_TARGET_AVX512 static void find_matching(std::span<const T> data, const P& pred, std::uintptr_t first_offset, std::vector<std::uintptr_t>& out)
+        {
+            constexpr std::size_t lanes = 64 / sizeof(T);
+            std::size_t i = 0;
+            for (; i + lanes <= data.size(); i += lanes)
+            {
+                append_mask<T>(match_mask(data.data() + i, pred), i, first_offset, out);
+            }
+            find_matching_scalar(data, pred, i, first_offset, out);
+        }
+    };
+
+#endif
+
+    // Appends first_offset + i * sizeof(T) for every element data[i] that passes 'pred', in increasing order.
+    template <typename T, typename P>
+    void find_matching(std::span<const T> data, const P& pred, std::uintptr_t first_offset, std::vector<std::uintptr_t>& out)
+    {
+#ifdef SCANNER_X86
+        switch (active_isa())
+        {
+            case Isa::avx512: return Avx512::find_matching(data, pred, first_offset, out);
+            case Isa::avx2: return Avx2::find_matching(data, pred, first_offset, out);
+            case Isa::sse2: return Sse2::find_matching(data, pred, first_offset, out);
+            default: break;
+        }
+#endif
+        find_matching_scalar(data, pred, 0, first_offset, out);
+    }
+
+    // Appends first_offset + i * sizeof(T) for every element data[i] that values_equal 'val', in increasing order.
+    template <typename T>
+    void find_equal(std::span<const T> data, T val, std::uintptr_t first_offset, std::vector<std::uintptr_t>& out)
+    {
+        find_matching(data, Equal<T>{ val }, first_offset, out);
+    }
+
+    // Like find_equal, but matches 'val' starting at any byte: appends first_offset + i for every i < limit where the
+    // sizeof(T) bytes at bytes[i] (all within 'bytes') equal 'val', in increasing order.
+    // Runs the aligned kernel once per byte shift, then sorts the shifts' matches together.
+    template <typename T>
+    void find_equal_unaligned(std::span<const std::byte> bytes, std::size_t limit, T val, std::uintptr_t first_offset, std::vector<std::uintptr_t>& out)
+    {
+        const std::size_t first_match = out.size();
+        for (std::size_t shift = 0; shift < sizeof(T) and shift < limit and shift < bytes.size(); ++shift)
+        {
+            const std::size_t count = std::min((limit - shift + sizeof(T) - 1) / sizeof(T), (bytes.size() - shift) / sizeof(T));
+            find_equal<T>({ reinterpret_cast<const T*>(bytes.data() + shift), count }, val, first_offset + shift, out);
+        }
+        if constexpr(sizeof(T) > 1)
+        {
+            std::sort(out.begin() + static_cast<std::ptrdiff_t>(first_match), out.end());
+        }
+    }
+
+}
+
+#endif //SCANNER_COMPAREKERNELS_H
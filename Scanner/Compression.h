@@ -0,0 +1,227 @@
+#ifndef SCANNER_COMPRESSION_H
+#define SCANNER_COMPRESSION_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// Small self contained codec for memory snapshots.
+// Data is cut into 64 KiB frames and each frame is stored as the first of these that applies:
+// all zero, one repeated 8 byte word, LZ77 compressed (if smaller), raw.
+namespace Compression
+{
+
+    constexpr std::size_t frame_size = 64 * 1024;
+
+    enum class FrameKind : std::uint8_t
+    {
+        zero,
+        repeat,
+        lz,
+        raw,
+    };
+
+    inline void write_varint(std::vector<std::uint8_t>& out, std::uint64_t val)
+    {
+        while (val >= 0x80)
+        {
+            out.push_back(static_cast<std::uint8_t>(val | 0x80));
+            val >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(val));
+    }
+
+    [[noreturn]] inline void corrupt_frame()
+    {
+        throw std::runtime_error("Corrupt compressed frame.");
+    }
+
+    // Reads a varint from src at pos. Compressed data may come from a file, so every read is checked against its end.
+    inline std::uint64_t read_varint(std::span<const std::uint8_t> src, std::size_t& pos)
+    {
+        std::uint64_t val = 0;
+        int shift = 0;
+        std::uint8_t byte;
+        do
+        {
+            if (pos >= src.size() or shift >= 64)
+                corrupt_frame();
+            byte = src[pos++];
+            val |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        return val;
+    }
+
+    // Greedy LZ77 over one frame: sequences of (literal count, literals, match length, match distance),
+    // ending with a sequence whose match length is 0. Matches are found through a hash of the next 4 bytes.
+    inline void lz_compress(const std::uint8_t* src, std::size_t size, std::vector<std::uint8_t>& out)
+    {
+        constexpr std::size_t min_match = 4;
+        constexpr int hash_bits = 13;
+        std::array<std::uint32_t, 1 << hash_bits> table;
+        table.fill(UINT32_MAX);
+
+        auto hash = [src](std::size_t pos)
+        {
+            std::uint32_t word;
+            std::memcpy(&word, src + pos, 4);
+            return (word * 2654435761u) >> (32 - hash_bits);
+        };
+
+        std::size_t literal_start = 0;
+        std::size_t pos = 0;
+        while (pos + min_match <= size)
+        {
+            auto& slot = table[hash(pos)];
+            std::size_t candidate = slot;
+            slot = static_cast<std::uint32_t>(pos);
+
+            if (candidate != UINT32_MAX and std::memcmp(src + candidate, src + pos, min_match) == 0)
+            {
+                std::size_t length = min_match;
+                while (pos + length < size and src[candidate + length] == src[pos + length])
+                {
+                    ++length;
+                }
+
+                write_varint(out, pos - literal_start);
+                out.insert(out.end(), src + literal_start, src + pos);
+                write_varint(out, length);
+                write_varint(out, pos - candidate);
+
+                pos += length;
+                literal_start = pos;
+            }
+            else
+            {
+                ++pos;
+            }
+        }
+
+        write_varint(out, size - literal_start);
+        out.insert(out.end(), src + literal_start, src + size);
+        write_varint(out, 0);
+    }
+
+    inline void lz_decompress(std::span<const std::uint8_t> src, std::size_t& pos, std::uint8_t* dst, std::size_t size)
+    {
+        std::size_t written = 0;
+        while (true)
+        {
+            std::uint64_t literals = read_varint(src, pos);
+            if (literals > size - written or literals > src.size() - pos)
+                corrupt_frame();
+            std::memcpy(dst + written, src.data() + pos, literals);
+            pos += literals;
+            written += literals;
+
+            std::uint64_t length = read_varint(src, pos);
+            if (length == 0)
+                return;
+
+            std::uint64_t distance = read_varint(src, pos);
+            if (distance == 0 or distance > written or length > size - written)
+                corrupt_frame();
+
+            // Byte by byte, matches may overlap their own output.
+            for (std::size_t i = 0; i < length; ++i, ++written)
+            {
+                dst[written] = dst[written - distance];
+            }
+        }
+    }
+
+    inline void compress_frame(const std::uint8_t* src, std::size_t size, std::vector<std::uint8_t>& out)
+    {
+        std::uint64_t word = 0;
+        std::memcpy(&word, src, std::min<std::size_t>(size, sizeof word));
+        bool repeats = size % sizeof word == 0;
+        for (std::size_t i = 0; repeats and i < size; i += sizeof word)
+        {
+            repeats = std::memcmp(src + i, &word, sizeof word) == 0;
+        }
+
+        if (repeats and word == 0)
+        {
+            out.push_back(static_cast<std::uint8_t>(FrameKind::zero));
+            return;
+        }
+
+        if (repeats)
+        {
+            out.push_back(static_cast<std::uint8_t>(FrameKind::repeat));
+            out.insert(out.end(), reinterpret_cast<const std::uint8_t*>(&word), reinterpret_cast<const std::uint8_t*>(&word) + sizeof word);
+            return;
+        }
+
+        const std::size_t frame_start = out.size();
+        out.push_back(static_cast<std::uint8_t>(FrameKind::lz));
+        lz_compress(src, size, out);
+
+        if (out.size() - frame_start > size)
+        {
+            out.resize(frame_start);
+            out.push_back(static_cast<std::uint8_t>(FrameKind::raw));
+            out.insert(out.end(), src, src + size);
+        }
+    }
+
+    // Appends the compressed form of data to out.
+    inline void compress(std::span<const std::byte> data, std::vector<std::uint8_t>& out)
+    {
+        auto src = reinterpret_cast<const std::uint8_t*>(data.data());
+        for (std::size_t frame = 0; frame < data.size(); frame += frame_size)
+        {
+            compress_frame(src + frame, std::min(frame_size, data.size() - frame), out);
+        }
+    }
+
+    // Restores data.size() bytes compressed by 'compress' from src. Throws if src is cut short or not the output of
+    // compress for that size.
+    inline void decompress(std::span<const std::uint8_t> src, std::span<std::byte> data)
+    {
+        auto dst = reinterpret_cast<std::uint8_t*>(data.data());
+        std::size_t pos = 0;
+        for (std::size_t frame = 0; frame < data.size(); frame += frame_size)
+        {
+            const std::size_t size = std::min(frame_size, data.size() - frame);
+            if (pos >= src.size())
+                corrupt_frame();
+
+            switch (static_cast<FrameKind>(src[pos++]))
+            {
+                case FrameKind::zero:
+                    std::memset(dst + frame, 0, size);
+                    break;
+                case FrameKind::repeat:
+                    // compress only emits repeats for frames of whole words.
+                    if (size % 8 != 0 or src.size() - pos < 8)
+                        corrupt_frame();
+                    for (std::size_t i = 0; i < size; i += 8)
+                        std::memcpy(dst + frame + i, src.data() + pos, 8);
+                    pos += 8;
+                    break;
+                case FrameKind::lz:
+                    lz_decompress(src, pos, dst + frame, size);
+                    break;
+                case FrameKind::raw:
+                    if (src.size() - pos < size)
+                        corrupt_frame();
+                    std::memcpy(dst + frame, src.data() + pos, size);
+                    pos += size;
+                    break;
+                default:
+                    corrupt_frame();
+            }
+        }
+    }
+
+}
+
+#endif //SCANNER_COMPRESSION_H
@@ -0,0 +1,289 @@
+#ifndef SCANNER_COREFILE_H
+#define SCANNER_COREFILE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MappedFile.h"
+#include "MemorySource.h"
+
+// Minimal ELF definitions for reading core dumps, independent of the host's <elf.h>. Little endian only.
+namespace ElfFormat
+{
+
+    constexpr unsigned char magic[4] = { 0x7f, 'E', 'L', 'F' };
+    constexpr unsigned char class_32 = 1;
+    constexpr unsigned char class_64 = 2;
+    constexpr unsigned char data_little_endian = 1;
+    constexpr std::uint16_t type_core = 4;
+
+    constexpr std::uint32_t pt_load = 1;
+    constexpr std::uint32_t pt_note = 4;
+    constexpr std::uint32_t pf_x = 1;
+    constexpr std::uint32_t pf_w = 2;
+    constexpr std::uint32_t pf_r = 4;
+
+    constexpr std::uint32_t nt_prstatus = 1;
+    constexpr std::uint32_t nt_auxv = 6;
+    constexpr std::uint32_t nt_file = 0x46494c45;
+    constexpr std::uint64_t at_entry = 9;
+
+    template <typename Word>
+    struct Header
+    {
+        unsigned char ident[16];
+        std::uint16_t type;
+        std::uint16_t machine;
+        std::uint32_t version;
+        Word entry;
+        Word phoff;
+        Word shoff;
+        std::uint32_t flags;
+        std::uint16_t ehsize;
+        std::uint16_t phentsize;
+        std::uint16_t phnum;
+        std::uint16_t shentsize;
+        std::uint16_t shnum;
+        std::uint16_t shstrndx;
+    };
+
+    struct ProgramHeader32
+    {
+        std::uint32_t type;
+        std::uint32_t offset;
+        std::uint32_t vaddr;
+        std::uint32_t paddr;
+        std::uint32_t filesz;
+        std::uint32_t memsz;
+        std::uint32_t flags;
+        std::uint32_t align;
+    };
+
+    struct ProgramHeader64
+    {
+        std::uint32_t type;
+        std::uint32_t flags;
+        std::uint64_t offset;
+        std::uint64_t vaddr;
+        std::uint64_t paddr;
+        std::uint64_t filesz;
+        std::uint64_t memsz;
+        std::uint64_t align;
+    };
+
+    static_assert(sizeof(Header<std::uint32_t>) == 52 and sizeof(Header<std::uint64_t>) == 64);
+    static_assert(sizeof(ProgramHeader32) == 32 and sizeof(ProgramHeader64) == 56);
+
+}
+
+// An ELF core dump opened as a read only memory source. PT_LOAD segments become the regions and are scanned in place
+// from the mapped file; the NT_FILE note names the mapped files, which gives the executable (the file containing
+// the entry point from NT_AUXV), its base address and module range. Without either note the base address is 0 and
+// the module range empty. Parts of segments the dump left out (file backed pages, per coredump_filter) are not readable.
+class CoreFileSource final : public LocalMemorySource
+{
+    struct MappedFileEntry
+    {
+        std::uintptr_t start;
+        std::uintptr_t end;
+        std::string path;
+    };
+
+    MappedFile file;
+    bool bit64 = false;
+    unsigned long process_id = 0;
+    std::string name;
+    std::uintptr_t base_address = 0;
+    AddressRange module_range { 0, 0 };
+    std::vector<MappedFileEntry> mapped_files;
+    std::uintptr_t entry_point = 0;
+
+    [[noreturn]] static void corrupt()
+    {
+        throw std::runtime_error("Corrupt core file.");
+    }
+
+    template <typename T>
+    T load(std::span<const std::byte> bytes, std::uint64_t offset) const
+    {
+        if (offset > bytes.size() or sizeof(T) > bytes.size() - offset)
+            corrupt();
+
+        T val;
+        std::memcpy(&val, bytes.data() + offset, sizeof val);
+        return val;
+    }
+
+    template <typename Word>
+    void parse_file_note(std::span<const std::byte> desc)
+    {
+        const auto count = load<Word>(desc, 0);
+        std::uint64_t pos = 2 * sizeof(Word);
+        std::uint64_t names = pos + count * 3 * sizeof(Word);
+        for (Word i = 0; i < count; ++i, pos += 3 * sizeof(Word))
+        {
+            if (names >= desc.size())
+                corrupt();
+            auto path_start = reinterpret_cast<const char*>(desc.data() + names);
+            const std::string_view path { path_start, strnlen(path_start, desc.size() - names) };
+            names += path.size() + 1;
+
+            mapped_files.push_back({ load<Word>(desc, pos), load<Word>(desc, pos + sizeof(Word)), std::string{ path } });
+        }
+    }
+
+    template <typename Word>
+    void parse_notes(std::span<const std::byte> notes)
+    {
+        auto align4 = [](std::uint64_t size){ return (size + 3) / 4 * 4; };
+
+        std::uint64_t pos = 0;
+        while (pos + 12 <= notes.size())
+        {
+            const auto name_size = load<std::uint32_t>(notes, pos);
+            const auto desc_size = load<std::uint32_t>(notes, pos + 4);
+            const auto type = load<std::uint32_t>(notes, pos + 8);
+            const std::uint64_t desc_pos = pos + 12 + align4(name_size);
+            if (desc_pos > notes.size() or desc_size > notes.size() - desc_pos)
+                corrupt();
+            std::span<const std::byte> desc = notes.subspan(desc_pos, desc_size);
+
+            if (type == ElfFormat::nt_file)
+            {
+                parse_file_note<Word>(desc);
+            }
+            else if (type == ElfFormat::nt_auxv)
+            {
+                for (std::uint64_t at = 0; at + 2 * sizeof(Word) <= desc.size(); at += 2 * sizeof(Word))
+                {
+                    if (load<Word>(desc, at) == ElfFormat::at_entry)
+                        entry_point = load<Word>(desc, at + sizeof(Word));
+                }
+            }
+            else if (type == ElfFormat::nt_prstatus and process_id == 0)
+            {
+                // elf_prstatus: siginfo (3 ints), cursig (short, padded), sigpend and sighold (longs), then pr_pid.
+                process_id = load<std::int32_t>(desc, 16 + 2 * sizeof(Word));
+            }
+
+            pos = desc_pos + align4(desc_size);
+        }
+    }
+
+    template <typename Word, typename ProgramHeader>
+    void parse()
+    {
+        std::span<const std::byte> bytes = file.bytes();
+        const auto header = load<ElfFormat::Header<Word>>(bytes, 0);
+        if (header.type != ElfFormat::type_core)
+            throw std::runtime_error("Not a core file.");
+        if (header.phentsize != sizeof(ProgramHeader))
+            corrupt();
+
+        for (std::uint16_t i = 0; i < header.phnum; ++i)
+        {
+            const auto segment = load<ProgramHeader>(bytes, header.phoff + static_cast<std::uint64_t>(i) * sizeof(ProgramHeader));
+            if (segment.offset > bytes.size() or segment.filesz > bytes.size() - segment.offset)
+                corrupt();
+
+            if (segment.type == ElfFormat::pt_note)
+            {
+                parse_notes<Word>(bytes.subspan(segment.offset, segment.filesz));
+            }
+            else if (segment.type == ElfFormat::pt_load and (segment.flags & ElfFormat::pf_r) and segment.filesz > 0)
+            {
+                const MemoryRegion region { { segment.vaddr, segment.filesz }, (segment.flags & ElfFormat::pf_w) != 0, (segment.flags & ElfFormat::pf_x) != 0, false };
+                local_regions.push_back({ region, bytes.data() + segment.offset });
+            }
+        }
+    }
+
+    void find_module()
+    {
+        auto executable = std::find_if(mapped_files.begin(), mapped_files.end(), [this](const MappedFileEntry& entry)
+        {
+            return entry_point >= entry.start and entry_point < entry.end;
+        });
+        if (executable == mapped_files.end())
+        {
+            // No NT_FILE note or no AT_ENTRY: the memory can still be scanned, with absolute offsets and no module.
+            name = "(unknown executable)";
+            return;
+        }
+
+        const std::string path = executable->path;
+        name = path.substr(path.find_last_of('/') + 1);
+
+        std::uintptr_t start = UINTPTR_MAX;
+        std::uintptr_t end = 0;
+        for (const MappedFileEntry& entry : mapped_files)
+        {
+            if (entry.path == path)
+            {
+                start = std::min(start, entry.start);
+                end = std::max(end, entry.end);
+            }
+        }
+
+        // .bss past the end of the file is an anonymous segment right after the image.
+        for (const LocalRegion& local : local_regions)
+        {
+            if (local.region.range.start() == end and local.region.anonymous)
+                end = local.region.range.end();
+        }
+
+        base_address = start;
+        module_range = { start, end - start };
+    }
+
+public:
+
+    explicit CoreFileSource(const std::string& path)
+        :   file(path)
+    {
+        std::span<const std::byte> bytes = file.bytes();
+        const auto ident = load<std::array<unsigned char, 16>>(bytes, 0);
+        if (std::memcmp(ident.data(), ElfFormat::magic, sizeof ElfFormat::magic) != 0 or ident[5] != ElfFormat::data_little_endian)
+            throw std::runtime_error(path + " is not a little endian ELF file.");
+
+        bit64 = ident[4] == ElfFormat::class_64;
+        if (bit64)
+            parse<std::uint64_t, ElfFormat::ProgramHeader64>();
+        else
+            parse<std::uint32_t, ElfFormat::ProgramHeader32>();
+
+        for (LocalRegion& local : local_regions)
+        {
+            local.region.anonymous = std::none_of(mapped_files.begin(), mapped_files.end(), [&](const MappedFileEntry& entry)
+            {
+                return local.region.range.start() < entry.end and entry.start < local.region.range.end();
+            });
+        }
+        sort_local_regions();
+        find_module();
+    }
+
+    std::string_view get_name() const override { return name; }
+    unsigned long get_id() const override { return process_id; }
+    bool is_64_bit() const override { return bit64; }
+    std::uintptr_t get_base_address() const override { return base_address; }
+    AddressRange get_module_range() const override { return module_range; }
+
+    // Whether the file at path starts like an ELF file.
+    static bool is_elf_file(const std::string& path)
+    {
+        std::ifstream in { path, std::ios::binary };
+        char file_magic[sizeof ElfFormat::magic];
+        return in.read(file_magic, sizeof file_magic) and std::memcmp(file_magic, ElfFormat::magic, sizeof file_magic) == 0;
+    }
+};
+
+#endif //SCANNER_COREFILE_H
@@ -0,0 +1,77 @@
+#ifndef SCANNER_INTERVALINDEX_H
+#define SCANNER_INTERVALINDEX_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "AddressRange.h"
+
+// Point lookups over sorted, disjoint address ranges without branching on the data.
+// The range ends are stored in Eytzinger (breadth first binary tree) order, so a search walks down the tree touching
+// one cache line per level and the comparison only selects the child. The first range ending after the address is
+// the only one that can contain it.
+class IntervalIndex
+{
+    // 1-based tree: node k has children 2k and 2k + 1, slot 0 is unused.
+    std::vector<std::uintptr_t> ends;
+    std::vector<std::uintptr_t> starts;
+    std::vector<std::uint32_t> ids; // position of the range in the sorted input.
+
+    std::size_t fill(std::span<const AddressRange> ranges, std::size_t next, std::size_t k)
+    {
+        if (k < ends.size())
+        {
+            next = fill(ranges, next, 2 * k);
+            ends[k] = ranges[next].end();
+            starts[k] = ranges[next].start();
+            ids[k] = static_cast<std::uint32_t>(next);
+            ++next;
+            next = fill(ranges, next, 2 * k + 1);
+        }
+        return next;
+    }
+
+public:
+
+    static constexpr std::uint32_t npos = UINT32_MAX;
+
+    IntervalIndex() = default;
+
+    // ranges must be sorted by start and must not overlap.
+    explicit IntervalIndex(std::span<const AddressRange> ranges)
+        :   ends(ranges.size() + 1), starts(ranges.size() + 1), ids(ranges.size() + 1, npos)
+    {
+        fill(ranges, 0, 1);
+    }
+
+    // Position of the range containing the address, or npos.
+    std::uint32_t find(std::uintptr_t address) const
+    {
+        const std::size_t n = ends.size();
+        std::size_t k = 1;
+        while (k < n)
+        {
+            k = 2 * k + (ends[k] <= address);
+        }
+        // Undo the trailing right turns (and the last left turn) to reach the first end greater than the address.
+        k >>= std::countr_one(k) + 1;
+
+        if (k == 0 or starts[k] > address)
+            return npos;
+        return ids[k];
+    }
+
+    bool contains(std::uintptr_t address) const
+    {
+        return find(address) != npos;
+    }
+
+    std::size_t size() const
+    {
+        return ends.empty() ? 0 : ends.size() - 1;
+    }
+};
+
+#endif //SCANNER_INTERVALINDEX_H
@@ -0,0 +1,424 @@
+#ifndef SCANNER_LINUXPROCESS_H
+#define SCANNER_LINUXPROCESS_H
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "AddressRange.h"
+#include "ProcessTypes.h"
+
+// One line of /proc/<pid>/maps.
+struct MapsEntry
+{
+    std::uintptr_t start;
+    std::uintptr_t end;
+    char perms[5];
+    std::string path;
+};
+
+inline std::vector<MapsEntry> parse_maps(std::istream& in)
+{
+    std::vector<MapsEntry> entries;
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        // format: start-end perms offset dev inode [path]
+        MapsEntry entry {};
+        unsigned long long start, end;
+        char perms[5];
+        int path_pos = 0;
+        if (std::sscanf(line.c_str(), "%llx-%llx %4s %*s %*s %*s %n", &start, &end, perms, &path_pos) < 3)
+        {
+            continue;
+        }
+
+        entry.start = start;
+        entry.end = end;
+        std::memcpy(entry.perms, perms, sizeof perms);
+        if (path_pos > 0 and static_cast<std::size_t>(path_pos) < line.size())
+        {
+            entry.path = line.substr(path_pos);
+        }
+
+        entries.emplace_back(std::move(entry));
+    }
+
+    return entries;
+}
+
+// FNV-1a, used to tell whether /proc/<pid>/maps changed without parsing it.
+inline std::uint64_t hash_bytes(std::string_view bytes)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (char byte : bytes)
+    {
+        hash = (hash ^ static_cast<unsigned char>(byte)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Writes "4" (reset soft dirty bits) to a clear_refs file.
+inline bool write_clear_refs(const char* path)
+{
+    const int clear_refs = open(path, O_WRONLY | O_CLOEXEC);
+    if (clear_refs < 0)
+    {
+        return false;
+    }
+
+    const bool ok = write(clear_refs, "4", 1) == 1;
+    close(clear_refs);
+    return ok;
+}
+
+class Process
+{
+    std::string process_name;
+    pid_t process_id;
+    bool bit64;
+    std::uintptr_t base_address;
+    std::size_t module_size;
+
+    std::string proc_path(const char* file) const
+    {
+        return "/proc/" + std::to_string(process_id) + "/" + file;
+    }
+
+    std::vector<MapsEntry> read_maps() const
+    {
+        std::ifstream maps { proc_path("maps") };
+        if (!maps)
+        {
+            throw std::runtime_error("Could not read process memory map.");
+        }
+        return parse_maps(maps);
+    }
+
+    std::string read_maps_text() const
+    {
+        std::ifstream maps { proc_path("maps") };
+        if (!maps)
+        {
+            throw std::runtime_error("Could not read process memory map.");
+        }
+        return { std::istreambuf_iterator<char>{ maps }, std::istreambuf_iterator<char>{} };
+    }
+
+    std::string read_exe_path() const
+    {
+        char buf[PATH_MAX];
+        auto len = readlink(proc_path("exe").c_str(), buf, sizeof buf - 1);
+        if (len <= 0)
+        {
+            throw std::runtime_error("Could not read process executable.");
+        }
+        return { buf, static_cast<std::size_t>(len) };
+    }
+
+    bool read_exe_is_64_bit() const
+    {
+        // EI_CLASS of the executable's ELF header: 1 = 32 bit, 2 = 64 bit.
+        std::ifstream exe { proc_path("exe"), std::ios::binary };
+        char ident[5];
+        if (!exe.read(ident, sizeof ident) or std::memcmp(ident, "\x7f" "ELF", 4) != 0)
+        {
+            throw std::runtime_error("Could not read process executable header.");
+        }
+        return ident[4] == 2;
+    }
+
+    AddressRange scan_module(const std::string& exe_path) const
+    {
+        const std::vector<MapsEntry> entries = read_maps();
+
+        // maps is sorted by address, so the first mapping of the executable is its load address.
+        auto first = std::find_if(entries.begin(), entries.end(), [&](const MapsEntry& entry){ return entry.path == exe_path; });
+        if (first == entries.end())
+        {
+            throw std::runtime_error("Could not find base address.");
+        }
+
+        auto last = first;
+        for (auto it = first; it != entries.end(); ++it)
+        {
+            if (it->path == exe_path)
+                last = it;
+        }
+
+        // .bss past the end of the file is an anonymous mapping right after the image.
+        std::uintptr_t end = last->end;
+        auto next = std::next(last);
+        if (next != entries.end() and next->start == end and next->path.empty())
+        {
+            end = next->end;
+        }
+
+        return { first->start, end - first->start };
+    }
+
+public:
+
+    explicit Process(pid_t pid)
+        :   process_id(pid)
+    {
+        if (pid <= 0 or kill(pid, 0) != 0)
+        {
+            throw std::runtime_error("Could not find process (Is it running?).");
+        }
+
+        const std::string exe_path = read_exe_path();
+        process_name = exe_path.substr(exe_path.find_last_of('/') + 1);
+        bit64 = read_exe_is_64_bit();
+        AddressRange module = scan_module(exe_path);
+        base_address = module.start();
+        module_size = module.size();
+    }
+
+    std::string_view get_name() const
+    {
+        return process_name;
+    }
+
+    unsigned long get_id() const
+    {
+        return process_id;
+    }
+
+    bool is_64_bit() const
+    {
+        return bit64;
+    }
+
+    std::uintptr_t get_base_address() const
+    {
+        return base_address;
+    }
+
+    // Memory occupied by the executable's image (and its .bss), starting at the base address.
+    AddressRange get_module_range() const
+    {
+        return { base_address, module_size };
+    }
+
+    [[nodiscard]]
+    bool read(void* buf, std::uintptr_t from, std::size_t to_read) const
+    {
+        iovec local { buf, to_read };
+        iovec remote { reinterpret_cast<void*>(from), to_read };
+        return process_vm_readv(process_id, &local, 1, &remote, 1, 0) == static_cast<ssize_t>(to_read);
+    }
+
+    // Scatter reads all requests with as few process_vm_readv calls as possible (up to IOV_MAX requests per call).
+    // The kernel stops at the first remote iovec that faults, so a failing request is marked and the batch resumes after it.
+    std::size_t read_batch(std::span<ReadRequest> requests) const
+    {
+        constexpr std::size_t max_iov = IOV_MAX;
+        std::vector<iovec> local;
+        std::vector<iovec> remote;
+        local.reserve(std::min(requests.size(), max_iov));
+        remote.reserve(std::min(requests.size(), max_iov));
+
+        std::size_t num_ok = 0;
+        std::size_t next = 0;
+        while (next < requests.size())
+        {
+            const std::size_t batch_end = std::min(requests.size(), next + max_iov);
+            local.clear();
+            remote.clear();
+            for (std::size_t i = next; i < batch_end; ++i)
+            {
+                local.push_back({ requests[i].buffer, requests[i].size });
+                remote.push_back({ reinterpret_cast<void*>(requests[i].address), requests[i].size });
+            }
+
+            ssize_t transferred = process_vm_readv(process_id, local.data(), local.size(), remote.data(), remote.size(), 0);
+            std::size_t remaining = transferred > 0 ? static_cast<std::size_t>(transferred) : 0;
+
+            // Every request fully covered by the transferred byte count succeeded.
+            while (next < batch_end and remaining >= requests[next].size)
+            {
+                remaining -= requests[next].size;
+                requests[next].ok = true;
+                ++num_ok;
+                ++next;
+            }
+
+            // The request the transfer stopped in (possibly partially read) is unreadable, skip past it.
+            if (next < batch_end)
+            {
+                requests[next].ok = false;
+                ++next;
+            }
+        }
+
+        return num_ok;
+    }
+
+    // Replaces 'regions' with the readable regions of the process, unless the memory map still hashes to 'fingerprint'.
+    // Returns whether regions was replaced.
+    bool scan_regions(std::uint64_t& fingerprint, std::vector<MemoryRegion>& regions) const
+    {
+        const std::string text = read_maps_text();
+        const std::uint64_t hash = hash_bytes(text);
+        if (hash == fingerprint and !regions.empty())
+        {
+            return false;
+        }
+
+        std::istringstream in { text };
+        regions.clear();
+        for (const MapsEntry& entry : parse_maps(in))
+        {
+            if (entry.perms[0] == 'r' and !entry.path.starts_with("[vvar"))
+            {
+                const bool anonymous = entry.perms[3] == 'p' and (entry.path.empty() or entry.path == "[heap]" or entry.path.starts_with("[stack") or entry.path.starts_with("[anon:"));
+                regions.push_back({ { entry.start, entry.end - entry.start }, entry.perms[1] == 'w', entry.perms[2] == 'x', anonymous });
+            }
+        }
+
+        fingerprint = hash;
+        return true;
+    }
+
+    // Sets one bit per page of every anonymous region whose page was never faulted in (neither present nor swapped,
+    // /proc/<pid>/pagemap bits 63 and 62), so it still reads as zero. Other regions get an empty bitmap (unknown).
+    // pagemap entries are read in batches of 'entries_per_read' pages. Returns the page size the bitmaps are in.
+    std::size_t scan_untouched_pages(std::span<const MemoryRegion> regions, std::vector<std::vector<std::uint64_t>>& untouched) const
+    {
+        constexpr std::size_t entries_per_read = 8192;
+        constexpr std::uint64_t present_or_swapped = 3ull << 62;
+
+        const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        untouched.assign(regions.size(), {});
+        const int pagemap = open(proc_path("pagemap").c_str(), O_RDONLY | O_CLOEXEC);
+        if (pagemap < 0)
+        {
+            return page_size;
+        }
+
+        std::vector<std::uint64_t> entries(entries_per_read);
+        for (std::size_t i = 0; i < regions.size(); ++i)
+        {
+            if (!regions[i].anonymous)
+                continue;
+
+            const std::size_t first_page = regions[i].range.start() / page_size;
+            const std::size_t num_pages = regions[i].range.size() / page_size;
+            std::vector<std::uint64_t>& bits = untouched[i];
+            bits.assign((num_pages + 63) / 64, 0);
+
+            for (std::size_t page = 0; page < num_pages; page += entries_per_read)
+            {
+                const std::size_t count = std::min(entries_per_read, num_pages - page);
+                const auto bytes = static_cast<ssize_t>(count * sizeof(std::uint64_t));
+                if (pread(pagemap, entries.data(), bytes, static_cast<off_t>((first_page + page) * sizeof(std::uint64_t))) != bytes)
+                {
+                    bits.clear();
+                    break;
+                }
+
+                for (std::size_t k = 0; k < count; ++k)
+                {
+                    if (!(entries[k] & present_or_swapped))
+                        bits[(page + k) / 64] |= 1ull << ((page + k) % 64);
+                }
+            }
+        }
+
+        close(pagemap);
+        return page_size;
+    }
+
+    // Whether the kernel tracks soft dirty bits (CONFIG_MEM_SOFT_DIRTY). Without it clear_refs still accepts "4" and
+    // pagemap bit 55 simply stays clear, which would make every page look clean, so this is tested on a page of our own.
+    static bool dirty_tracking_supported()
+    {
+        const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        void* page = mmap(nullptr, page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (page == MAP_FAILED)
+        {
+            return false;
+        }
+
+        auto soft_dirty = [&]
+        {
+            std::uint64_t entry = 0;
+            const int pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+            if (pagemap >= 0)
+            {
+                if (pread(pagemap, &entry, sizeof entry, static_cast<off_t>(reinterpret_cast<std::uintptr_t>(page) / page_size * sizeof entry)) != sizeof entry)
+                    entry = 0;
+                close(pagemap);
+            }
+            return ((entry >> 55) & 1) != 0;
+        };
+
+        auto* byte = static_cast<volatile char*>(page);
+        *byte = 1;
+        bool supported = write_clear_refs("/proc/self/clear_refs") and !soft_dirty();
+        *byte = 2;
+        supported = supported and soft_dirty();
+
+        munmap(page, page_size);
+        return supported;
+    }
+
+    // Clears the soft dirty bit of every page of the process: from here on pagemap bit 55 marks pages written to.
+    bool reset_dirty_pages() const
+    {
+        return write_clear_refs(proc_path("clear_refs").c_str());
+    }
+
+    // Reads the soft dirty bits (pagemap bit 55) of the pages covering the range in one batch.
+    bool scan_dirty_pages(AddressRange range, DirtyPages& dirty) const
+    {
+        constexpr std::uint64_t soft_dirty = 1ull << 55;
+
+        const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        const std::uintptr_t first_page = range.start() / page_size;
+        const std::size_t num_pages = (range.end() + page_size - 1) / page_size - first_page;
+
+        const int pagemap = open(proc_path("pagemap").c_str(), O_RDONLY | O_CLOEXEC);
+        if (pagemap < 0)
+        {
+            return false;
+        }
+
+        std::vector<std::uint64_t> entries(num_pages);
+        const auto bytes = static_cast<ssize_t>(num_pages * sizeof(std::uint64_t));
+        const bool ok = pread(pagemap, entries.data(), bytes, static_cast<off_t>(first_page * sizeof(std::uint64_t))) == bytes;
+        close(pagemap);
+        if (!ok)
+        {
+            return false;
+        }
+
+        dirty.first_page = first_page;
+        dirty.page_size = page_size;
+        dirty.bits.assign((num_pages + 63) / 64, 0);
+        for (std::size_t i = 0; i < num_pages; ++i)
+        {
+            if (entries[i] & soft_dirty)
+                dirty.bits[i / 64] |= 1ull << (i % 64);
+        }
+        return true;
+    }
+};
+
+#endif //SCANNER_LINUXPROCESS_H
@@ -0,0 +1,94 @@
+#ifndef SCANNER_MAPPEDFILE_H
+#define SCANNER_MAPPEDFILE_H
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// A whole file mapped read only into memory.
+class MappedFile
+{
+    const std::byte* data = nullptr;
+    std::size_t length = 0;
+
+public:
+
+    explicit MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            throw std::runtime_error("Could not open " + path + ".");
+
+        LARGE_INTEGER size;
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &size) and size.QuadPart > 0)
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (!mapping)
+            throw std::runtime_error("Could not map " + path + ".");
+
+        data = static_cast<const std::byte*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+        if (!data)
+            throw std::runtime_error("Could not map " + path + ".");
+        length = static_cast<std::size_t>(size.QuadPart);
+#else
+        const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+            throw std::runtime_error("Could not open " + path + ".");
+
+        struct stat info;
+        void* mapped = MAP_FAILED;
+        if (fstat(file, &info) == 0 and info.st_size > 0)
+            mapped = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (mapped == MAP_FAILED)
+            throw std::runtime_error("Could not map " + path + ".");
+
+        data = static_cast<const std::byte*>(mapped);
+        length = static_cast<std::size_t>(info.st_size);
+#endif
+    }
+
+    MappedFile(const MappedFile& copy) = delete;
+    MappedFile& operator=(const MappedFile& copy) = delete;
+
+    MappedFile(MappedFile&& move) noexcept
+        :   data(std::exchange(move.data, nullptr)), length(std::exchange(move.length, 0))
+    {}
+
+    ~MappedFile()
+    {
+        if (!data)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<std::byte*>(data), length);
+#endif
+    }
+
+    std::span<const std::byte> bytes() const
+    {
+        return { data, length };
+    }
+
+    std::size_t size() const
+    {
+        return length;
+    }
+};
+
+#endif //SCANNER_MAPPEDFILE_H
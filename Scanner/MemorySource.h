@@ -0,0 +1,223 @@
+#ifndef SCANNER_MEMORYSOURCE_H
+#define SCANNER_MEMORYSOURCE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "AddressRange.h"
+#include "AsyncReader.h"
+#include "Process.h"
+#include "ProcessTypes.h"
+
+// The memory a Scanner works on: a live process, or a file holding a copy of one.
+// Sources without page residency or dirty tracking keep the defaults, which report both as unknown.
+class MemorySource
+{
+public:
+
+    virtual ~MemorySource() = default;
+
+    virtual std::string_view get_name() const = 0;
+    virtual unsigned long get_id() const = 0;
+    virtual bool is_64_bit() const = 0;
+    virtual std::uintptr_t get_base_address() const = 0;
+    virtual AddressRange get_module_range() const = 0;
+
+    [[nodiscard]]
+    virtual bool read(void* buf, std::uintptr_t from, std::size_t to_read) const = 0;
+    virtual std::size_t read_batch(std::span<ReadRequest> requests) const = 0;
+
+    // See Process::scan_regions.
+    virtual bool scan_regions(std::uint64_t& fingerprint, std::vector<MemoryRegion>& regions) const = 0;
+
+    virtual std::size_t scan_untouched_pages(std::span<const MemoryRegion> regions, std::vector<std::vector<std::uint64_t>>& untouched) const
+    {
+        untouched.assign(regions.size(), {});
+        return 4096;
+    }
+
+    virtual bool supports_dirty_tracking() const
+    {
+        return false;
+    }
+
+    virtual bool reset_dirty_pages() const
+    {
+        return false;
+    }
+
+    virtual bool scan_dirty_pages(AddressRange, DirtyPages&) const
+    {
+        return false;
+    }
+
+    // Sources whose memory is mapped into our own address space return [address, address + size) directly, so it can
+    // be scanned without a copy. Empty if the range is not within one region or the source has no such view.
+    virtual std::span<const std::byte> view(std::uintptr_t, std::size_t) const
+    {
+        return {};
+    }
+
+    // Whether view() can succeed at all, so callers can skip leasing a buffer.
+    virtual bool has_views() const
+    {
+        return false;
+    }
+
+    // A new reader that reads ahead while the caller compares, see AsyncReader. Null where reads are synchronous only.
+    virtual std::unique_ptr<AsyncReader> open_async_reader() const
+    {
+        return nullptr;
+    }
+};
+
+// A live process, see Process.
+class ProcessSource final : public MemorySource
+{
+    Process process;
+
+public:
+
+    explicit ProcessSource(Process process)
+        :   process(std::move(process))
+    {}
+
+    std::string_view get_name() const override { return process.get_name(); }
+    unsigned long get_id() const override { return process.get_id(); }
+    bool is_64_bit() const override { return process.is_64_bit(); }
+    std::uintptr_t get_base_address() const override { return process.get_base_address(); }
+    AddressRange get_module_range() const override { return process.get_module_range(); }
+
+    bool read(void* buf, std::uintptr_t from, std::size_t to_read) const override
+    {
+        return process.read(buf, from, to_read);
+    }
+
+    std::size_t read_batch(std::span<ReadRequest> requests) const override
+    {
+        return process.read_batch(requests);
+    }
+
+    bool scan_regions(std::uint64_t& fingerprint, std::vector<MemoryRegion>& regions) const override
+    {
+        return process.scan_regions(fingerprint, regions);
+    }
+
+    std::size_t scan_untouched_pages(std::span<const MemoryRegion> regions, std::vector<std::vector<std::uint64_t>>& untouched) const override
+    {
+        return process.scan_untouched_pages(regions, untouched);
+    }
+
+    bool supports_dirty_tracking() const override
+    {
+        return Process::dirty_tracking_supported();
+    }
+
+    bool reset_dirty_pages() const override
+    {
+        return process.reset_dirty_pages();
+    }
+
+    bool scan_dirty_pages(AddressRange range, DirtyPages& dirty) const override
+    {
+        return process.scan_dirty_pages(range, dirty);
+    }
+
+#ifndef _WIN32
+    std::unique_ptr<AsyncReader> open_async_reader() const override
+    {
+        return open_process_reader(process.get_id());
+    }
+#endif
+};
+
+// Base of sources whose regions are all held in our own memory (typically a mapped file): reads are copies and
+// view() points straight into the region's bytes.
+class LocalMemorySource : public MemorySource
+{
+protected:
+
+    struct LocalRegion
+    {
+        MemoryRegion region;
+        const std::byte* data;
+    };
+
+    std::vector<LocalRegion> local_regions; // sorted by address, set up by the derived class.
+
+    const LocalRegion* find_local(std::uintptr_t address, std::size_t size) const
+    {
+        auto it = std::upper_bound(local_regions.begin(), local_regions.end(), address, [](std::uintptr_t a, const LocalRegion& local){ return a < local.region.range.start(); });
+        if (it == local_regions.begin())
+            return nullptr;
+
+        const LocalRegion& local = *std::prev(it);
+        if (size > local.region.range.size() or address - local.region.range.start() > local.region.range.size() - size)
+            return nullptr;
+        return &local;
+    }
+
+    void sort_local_regions()
+    {
+        std::sort(local_regions.begin(), local_regions.end(), [](const LocalRegion& a, const LocalRegion& b){ return a.region.range.start() < b.region.range.start(); });
+    }
+
+public:
+
+    bool read(void* buf, std::uintptr_t from, std::size_t to_read) const override
+    {
+        std::span<const std::byte> bytes = view(from, to_read);
+        if (bytes.empty())
+            return false;
+
+        std::memcpy(buf, bytes.data(), to_read);
+        return true;
+    }
+
+    std::size_t read_batch(std::span<ReadRequest> requests) const override
+    {
+        std::size_t num_ok = 0;
+        for (ReadRequest& request : requests)
+        {
+            request.ok = read(request.buffer, request.address, request.size);
+            num_ok += request.ok;
+        }
+        return num_ok;
+    }
+
+    // The regions never change, they are reported once.
+    bool scan_regions(std::uint64_t& fingerprint, std::vector<MemoryRegion>& regions) const override
+    {
+        if (fingerprint == 1 and !regions.empty())
+            return false;
+
+        regions.clear();
+        for (const LocalRegion& local : local_regions)
+        {
+            regions.push_back(local.region);
+        }
+        fingerprint = 1;
+        return true;
+    }
+
+    std::span<const std::byte> view(std::uintptr_t address, std::size_t size) const override
+    {
+        const LocalRegion* local = find_local(address, size);
+        if (!local or size == 0)
+            return {};
+        return { local->data + (address - local->region.range.start()), size };
+    }
+
+    bool has_views() const override
+    {
+        return true;
+    }
+};
+
+#endif //SCANNER_MEMORYSOURCE_H
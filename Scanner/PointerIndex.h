@@ -0,0 +1,188 @@
+#ifndef SCANNER_POINTERINDEX_H
+#define SCANNER_POINTERINDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_set>
+#include <vector>
+
+// Reverse pointer index: for every address pointed to by some aligned, pointer sized value in scanned memory,
+// the addresses holding such a pointer. Stored flat (CSR): sorted unique targets, and for target i the sources
+// sources[first[i]] to sources[first[i + 1]] in increasing order.
+class PointerIndex
+{
+public:
+
+    struct Edge
+    {
+        std::uintptr_t target;
+        std::uintptr_t source;
+
+        auto operator<=>(const Edge& other) const = default;
+    };
+
+private:
+
+    std::vector<std::uintptr_t> targets;
+    std::vector<std::size_t> first;
+    std::vector<std::uintptr_t> sources;
+
+public:
+
+    PointerIndex() = default;
+
+    // Builds the index from unordered edges (consumed).
+    explicit PointerIndex(std::vector<Edge> edges)
+    {
+        std::sort(edges.begin(), edges.end());
+
+        sources.reserve(edges.size());
+        for (const Edge& edge : edges)
+        {
+            if (targets.empty() or targets.back() != edge.target)
+            {
+                targets.push_back(edge.target);
+                first.push_back(sources.size());
+            }
+            sources.push_back(edge.source);
+        }
+        first.push_back(sources.size());
+
+        targets.shrink_to_fit();
+        first.shrink_to_fit();
+    }
+
+    // Addresses holding a pointer to exactly 'target'.
+    std::span<const std::uintptr_t> pointers_to(std::uintptr_t target) const
+    {
+        auto it = std::lower_bound(targets.begin(), targets.end(), target);
+        if (it == targets.end() or *it != target)
+            return {};
+
+        auto i = static_cast<std::size_t>(it - targets.begin());
+        return std::span<const std::uintptr_t>{ sources }.subspan(first[i], first[i + 1] - first[i]);
+    }
+
+    // Number of pointers indexed.
+    std::size_t size() const
+    {
+        return sources.size();
+    }
+
+    // Index range [begin, end) of the targets within [low, high], for use with target_at and sources_of.
+    std::pair<std::size_t, std::size_t> targets_in(std::uintptr_t low, std::uintptr_t high) const
+    {
+        auto begin = std::lower_bound(targets.begin(), targets.end(), low);
+        auto end = std::upper_bound(begin, targets.end(), high);
+        return { static_cast<std::size_t>(begin - targets.begin()), static_cast<std::size_t>(end - targets.begin()) };
+    }
+
+    std::uintptr_t target_at(std::size_t i) const
+    {
+        return targets[i];
+    }
+
+    std::span<const std::uintptr_t> sources_of(std::size_t i) const
+    {
+        return std::span<const std::uintptr_t>{ sources }.subspan(first[i], first[i + 1] - first[i]);
+    }
+
+    std::size_t num_targets() const
+    {
+        return targets.size();
+    }
+
+    std::size_t num_pointers() const
+    {
+        return sources.size();
+    }
+
+    bool empty() const
+    {
+        return sources.empty();
+    }
+
+    std::size_t memory_usage() const
+    {
+        return (targets.capacity() + sources.capacity()) * sizeof(std::uintptr_t) + first.capacity() * sizeof(std::size_t);
+    }
+};
+
+// Tree of pointers leading to an address, built breadth first from a PointerIndex.
+// Node 0 is the root and the children of every node are contiguous, so the graph is a single flat array.
+// An address is expanded only the first time it is reached, later occurrences are marked as already seen,
+// which also stops cycles. Nodes at the depth limit are not expanded.
+class PointerGraph
+{
+public:
+
+    struct Node
+    {
+        std::uintptr_t offset;
+        std::uint32_t first_child = 0;
+        std::uint32_t num_children = 0;
+        std::uint16_t depth = 0;
+        bool seen_before = false; // address already expanded elsewhere in the graph (possibly a cycle).
+        bool depth_limited = false; // has pointers to it, but the depth limit was reached.
+    };
+
+private:
+
+    std::vector<Node> nodes;
+
+public:
+
+    // 'pointers_to' maps an offset to the offsets holding a pointer to it.
+    template <typename F>
+    PointerGraph(std::uintptr_t root, int max_depth, F&& pointers_to)
+    {
+        nodes.push_back({ root });
+        std::unordered_set<std::uintptr_t> expanded { root };
+
+        for (std::size_t i = 0; i < nodes.size(); ++i)
+        {
+            if (nodes[i].seen_before)
+                continue;
+
+            auto pointers = pointers_to(nodes[i].offset);
+            if (pointers.empty())
+                continue;
+
+            if (nodes[i].depth >= max_depth)
+            {
+                nodes[i].depth_limited = true;
+                continue;
+            }
+
+            nodes[i].first_child = static_cast<std::uint32_t>(nodes.size());
+            nodes[i].num_children = static_cast<std::uint32_t>(pointers.size());
+            const auto child_depth = static_cast<std::uint16_t>(nodes[i].depth + 1);
+            for (std::uintptr_t pointer : pointers)
+            {
+                Node child { pointer };
+                child.depth = child_depth;
+                child.seen_before = !expanded.insert(pointer).second;
+                nodes.push_back(child);
+            }
+        }
+    }
+
+    const Node& root() const
+    {
+        return nodes.front();
+    }
+
+    std::span<const Node> children(const Node& node) const
+    {
+        return std::span<const Node>{ nodes }.subspan(node.first_child, node.num_children);
+    }
+
+    std::size_t size() const
+    {
+        return nodes.size();
+    }
+};
+
+#endif //SCANNER_POINTERINDEX_H
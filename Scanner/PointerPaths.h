@@ -0,0 +1,96 @@
+#ifndef SCANNER_POINTERPATHS_H
+#define SCANNER_POINTERPATHS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// A pointer path [[base + static_offset] + offsets[0]] + ... + offsets[n - 1]: read the pointer at base + static_offset,
+// add the first offset, read the pointer there, and so on; the last offset leads to the target.
+struct PointerPathOptions
+{
+    int max_depth = 5; // number of pointers followed.
+    std::uintptr_t max_offset = 0x400; // largest field offset added to a pointer at each level.
+};
+
+// Streams pointer paths to a binary file:
+// header: "MAPP", u32 version, u32 pointer size, u32 max depth, u64 max offset, u64 target offset,
+// then per path: u32 number of offsets, u64 static offset, u64 offsets (outermost first).
+// Little endian (the host's byte order), no padding.
+class PointerPathWriter
+{
+    static constexpr std::size_t flush_size = 1024 * 1024;
+    static constexpr std::uint32_t version = 1;
+
+    std::ofstream file;
+    std::vector<char> buffer;
+    std::size_t num_paths = 0;
+
+    template <typename T>
+    void put(T val)
+    {
+        const auto* bytes = reinterpret_cast<const char*>(&val);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof val);
+    }
+
+public:
+
+    PointerPathWriter(const std::string& path, std::uint32_t pointer_size, const PointerPathOptions& options, std::uintptr_t target_offset)
+        :   file(path, std::ios::binary | std::ios::trunc)
+    {
+        if (!file)
+        {
+            throw std::runtime_error("Could not open file " + path + ".");
+        }
+
+        buffer.reserve(flush_size + 4096);
+        buffer.insert(buffer.end(), { 'M', 'A', 'P', 'P' });
+        put<std::uint32_t>(version);
+        put<std::uint32_t>(pointer_size);
+        put<std::uint32_t>(static_cast<std::uint32_t>(options.max_depth));
+        put<std::uint64_t>(options.max_offset);
+        put<std::uint64_t>(target_offset);
+    }
+
+    PointerPathWriter(const PointerPathWriter& copy) = delete;
+    PointerPathWriter& operator=(const PointerPathWriter& copy) = delete;
+
+    ~PointerPathWriter()
+    {
+        flush();
+    }
+
+    void write(std::uintptr_t static_offset, std::span<const std::uintptr_t> offsets)
+    {
+        put<std::uint32_t>(static_cast<std::uint32_t>(offsets.size()));
+        put<std::uint64_t>(static_offset);
+        for (std::uintptr_t offset : offsets)
+        {
+            put<std::uint64_t>(offset);
+        }
+        ++num_paths;
+
+        if (buffer.size() >= flush_size)
+        {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+
+    std::size_t size() const
+    {
+        return num_paths;
+    }
+};
+
+#endif //SCANNER_POINTERPATHS_H
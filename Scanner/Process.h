@@ -0,0 +1,13 @@
+#ifndef SCANNER_PROCESS_H
+#define SCANNER_PROCESS_H
+
+// Selects the platform backend. Both define a 'Process' class with the same interface:
+// get_name, get_id, is_64_bit, get_base_address, get_module_range, read, read_batch, scan_regions, scan_untouched_pages,
+// dirty_tracking_supported, reset_dirty_pages and scan_dirty_pages.
+#ifdef _WIN32
+#include "WindowsProcess.h"
+#else
+#include "LinuxProcess.h"
+#endif
+
+#endif //SCANNER_PROCESS_H
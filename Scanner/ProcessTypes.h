@@ -0,0 +1,57 @@
+#ifndef SCANNER_PROCESSTYPES_H
+#define SCANNER_PROCESSTYPES_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "AddressRange.h"
+
+// Platform independent page protection used when enumerating regions.
+// Executable pages are excluded from both, matching PAGE_READONLY / PAGE_READWRITE on Windows.
+enum class PageProtection
+{
+    read_only,
+    read_write,
+};
+
+// A readable region of the target's address space.
+struct MemoryRegion
+{
+    AddressRange range;
+    bool writable;
+    bool executable;
+    bool anonymous; // private memory not backed by a file: pages never touched read as zero.
+};
+
+// Pages of a range written since dirty tracking was last reset, see Process::scan_dirty_pages.
+struct DirtyPages
+{
+    std::uintptr_t first_page = 0;
+    std::size_t page_size = 0; // 0 if unknown: every page counts as dirty.
+    std::vector<std::uint64_t> bits; // one per page from first_page.
+
+    bool is_dirty(std::uintptr_t address, std::size_t size) const
+    {
+        if (page_size == 0)
+            return true;
+
+        for (std::uintptr_t page = address / page_size; page <= (address + size - 1) / page_size; ++page)
+        {
+            const std::size_t i = page - first_page;
+            if (i / 64 >= bits.size() or (bits[i / 64] >> (i % 64)) & 1)
+                return true;
+        }
+        return false;
+    }
+};
+
+// One entry of a batched read. 'ok' is set by Process::read_batch.
+struct ReadRequest
+{
+    std::uintptr_t address;
+    void* buffer;
+    std::size_t size;
+    bool ok = false;
+};
+
+#endif //SCANNER_PROCESSTYPES_H
@@ -0,0 +1,137 @@
+#ifndef SCANNER_REGIONMAP_H
+#define SCANNER_REGIONMAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "IntervalIndex.h"
+#include "MemorySource.h"
+
+// Cached table of the target's readable regions, sorted by address.
+// refresh() only rebuilds it when the source reports a changed memory map, and every rebuild bumps the generation,
+// so users can cheaply tell whether anything derived from an older table is stale.
+class RegionMap
+{
+    std::vector<MemoryRegion> regions;
+    IntervalIndex index;
+    std::vector<std::vector<std::uint64_t>> untouched; // per region, one bit per page never faulted in; empty if unknown.
+    std::size_t page_size = 4096;
+    std::uint64_t fingerprint = 0;
+    std::uint64_t generation = 0;
+
+public:
+
+    // Returns whether the table changed.
+    bool refresh(const MemorySource& source)
+    {
+        if (!source.scan_regions(fingerprint, regions))
+            return false;
+
+        std::sort(regions.begin(), regions.end(), [](const MemoryRegion& a, const MemoryRegion& b){ return a.range.start() < b.range.start(); });
+
+        std::vector<AddressRange> ranges;
+        ranges.reserve(regions.size());
+        for (const MemoryRegion& region : regions)
+        {
+            ranges.push_back(region.range);
+        }
+        index = IntervalIndex{ ranges };
+        untouched.assign(regions.size(), {});
+
+        ++generation;
+        return true;
+    }
+
+    // The region containing the address, or nullptr if it is not mapped readable. Answered in process, without syscalls.
+    const MemoryRegion* find(std::uintptr_t address) const
+    {
+        const std::uint32_t i = index.find(address);
+        return i == IntervalIndex::npos ? nullptr : &regions[i];
+    }
+
+    // Re-reads which pages of anonymous regions were never touched by the target. Residency changes all the time,
+    // so this is done once per scan even when the table itself is unchanged.
+    void refresh_residency(const MemorySource& source)
+    {
+        page_size = source.scan_untouched_pages(regions, untouched);
+    }
+
+    // Calls on_run(address, size, zero) for consecutive runs of pages covering [address, address + size), which must
+    // lie in one region. zero runs are known to read as zero and need not be read.
+    template <typename F>
+    void for_each_page_run(std::uintptr_t address, std::size_t size, F&& on_run) const
+    {
+        const std::uint32_t i = index.find(address);
+        if (i == IntervalIndex::npos or untouched[i].empty())
+        {
+            on_run(address, size, false);
+            return;
+        }
+
+        const std::vector<std::uint64_t>& bits = untouched[i];
+        const std::uintptr_t region_start = regions[i].range.start();
+        const std::uintptr_t end = address + size;
+        auto is_zero = [&](std::uintptr_t at)
+        {
+            const std::size_t page = (at - region_start) / page_size;
+            return ((bits[page / 64] >> (page % 64)) & 1) != 0;
+        };
+
+        std::uintptr_t run_start = address;
+        bool run_zero = is_zero(address);
+        for (std::uintptr_t page = (address / page_size + 1) * page_size; page < end; page += page_size)
+        {
+            if (is_zero(page) != run_zero)
+            {
+                on_run(run_start, page - run_start, run_zero);
+                run_start = page;
+                run_zero = !run_zero;
+            }
+        }
+        on_run(run_start, end - run_start, run_zero);
+    }
+
+    // Whether [address, address + size) lies inside one readable region.
+    bool is_readable(std::uintptr_t address, std::size_t size = 1) const
+    {
+        const MemoryRegion* region = find(address);
+        return region and address + size <= region->range.end();
+    }
+
+    // Readable, non executable regions in address order: the memory scans look at.
+    std::vector<AddressRange> get_data_pages() const
+    {
+        std::vector<AddressRange> pages;
+        for (const MemoryRegion& region : regions)
+        {
+            if (!region.executable)
+                pages.push_back(region.range);
+        }
+        return pages;
+    }
+
+    // Every readable region in address order, code included.
+    std::vector<AddressRange> get_readable_pages() const
+    {
+        std::vector<AddressRange> pages;
+        for (const MemoryRegion& region : regions)
+        {
+            pages.push_back(region.range);
+        }
+        return pages;
+    }
+
+    std::span<const MemoryRegion> get_regions() const
+    {
+        return regions;
+    }
+
+    std::uint64_t get_generation() const
+    {
+        return generation;
+    }
+};
+
+#endif //SCANNER_REGIONMAP_H
@@ -0,0 +1,130 @@
+#ifndef SCANNER_SCANCONTROL_H
+#define SCANNER_SCANCONTROL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <vector>
+
+// Thrown out of a scan stopped with ScanControl::cancel. The scanner's results and where chain are as they were before
+// the call that threw.
+class ScanCancelled : public std::exception
+{
+public:
+
+    const char* what() const noexcept override
+    {
+        return "Scan cancelled.";
+    }
+};
+
+// Progress, first results and cancellation of the scans of one command, shared between the thread running the command
+// and the threads watching it. Scans report every window or candidate block they finish and check for cancellation
+// before starting the next one.
+class ScanControl
+{
+    std::atomic<bool> cancel_requested = false;
+    std::atomic<std::uint64_t> cancellations = 0;
+    std::atomic<std::uint64_t> bytes_total = 0;
+    std::atomic<std::uint64_t> bytes_done = 0;
+    std::atomic<std::uint64_t> matches = 0;
+
+    std::mutex hits_mutex;
+    std::vector<std::uintptr_t> first_hits;
+    std::atomic<bool> hits_full = false;
+
+public:
+
+    static constexpr std::size_t max_first_hits = 16;
+
+    struct Progress
+    {
+        std::uint64_t bytes_done;
+        std::uint64_t bytes_total;
+        std::uint64_t matches;
+    };
+
+    // Clears the progress, first hits and any cancellation request left from the previous command.
+    void begin_command()
+    {
+        cancel_requested = false;
+        bytes_total = 0;
+        bytes_done = 0;
+        matches = 0;
+        std::scoped_lock lock { hits_mutex };
+        first_hits.clear();
+        hits_full = false;
+    }
+
+    // Asks the running scan to stop. Only stores a lock free atomic, so it can be called from a signal handler.
+    void cancel()
+    {
+        cancel_requested.store(true, std::memory_order_relaxed);
+    }
+
+    bool is_cancelled() const
+    {
+        return cancel_requested.load(std::memory_order_relaxed);
+    }
+
+    void throw_if_cancelled()
+    {
+        if (is_cancelled())
+        {
+            ++cancellations;
+            throw ScanCancelled{};
+        }
+    }
+
+    // Number of scans stopped so far, to tell whether one was stopped since some point.
+    std::uint64_t get_cancellations() const
+    {
+        return cancellations;
+    }
+
+    // Bytes a scan pass is about to go through, added to the command's total.
+    void add_work(std::uint64_t bytes)
+    {
+        bytes_total.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void finish_work(std::uint64_t bytes)
+    {
+        bytes_done.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    // Reports the matches of a finished window or block, keeping the first max_first_hits of the command.
+    void publish(std::span<const std::uintptr_t> offsets)
+    {
+        if (offsets.empty())
+            return;
+
+        matches.fetch_add(offsets.size(), std::memory_order_relaxed);
+        if (hits_full.load(std::memory_order_relaxed))
+            return;
+
+        std::scoped_lock lock { hits_mutex };
+        const std::size_t take = std::min(offsets.size(), max_first_hits - std::min(first_hits.size(), max_first_hits));
+        first_hits.insert(first_hits.end(), offsets.begin(), offsets.begin() + take);
+        if (first_hits.size() == max_first_hits)
+            hits_full = true;
+    }
+
+    Progress get_progress() const
+    {
+        return { bytes_done.load(std::memory_order_relaxed), bytes_total.load(std::memory_order_relaxed), matches.load(std::memory_order_relaxed) };
+    }
+
+    // The first matches published by the command, in the order windows finished.
+    std::vector<std::uintptr_t> get_first_hits()
+    {
+        std::scoped_lock lock { hits_mutex };
+        return first_hits;
+    }
+};
+
+#endif //SCANNER_SCANCONTROL_H
@@ -0,0 +1,307 @@
+#ifndef SCANNER_SCANSTATS_H
+#define SCANNER_SCANSTATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Where the time of a scan goes.
+enum class ScanPhase
+{
+    regions, // refreshing the region map and page residency.
+    scan, // streaming windows of memory through a compare, wall time.
+    read, // loading windows (waiting on reads in flight, with read ahead), summed over scan threads.
+    compare, // comparing loaded windows, summed over scan threads.
+    filter, // re-reading and testing the candidates of a chain step, wall time.
+    merge, // merging per window and per block results.
+};
+
+enum class ScanCounter
+{
+    bytes_requested,
+    bytes_read,
+    bytes_zero, // of pages known to be untouched, zero filled instead of read.
+    read_calls,
+    read_failures,
+    regions_visited,
+    regions_skipped, // regions of the map a scan leaves out (code, or unreadable).
+    windows,
+    windows_unreadable,
+    matches,
+};
+
+// Counters and phase timers of the command being run, cheap enough to stay on in every scan: relaxed atomics, and a
+// clock read at the start and end of each timed phase (per window at most, never per value).
+// With tracing on, every timed phase is also recorded as an event, for write_trace.
+class ScanStats
+{
+public:
+
+    static constexpr std::size_t num_phases = static_cast<std::size_t>(ScanPhase::merge) + 1;
+    static constexpr std::size_t num_counters = static_cast<std::size_t>(ScanCounter::matches) + 1;
+
+private:
+
+    using Clock = std::chrono::steady_clock;
+
+    struct TraceEvent
+    {
+        std::string name;
+        std::uint32_t thread;
+        Clock::time_point start;
+        Clock::duration duration;
+    };
+
+    std::array<std::atomic<std::uint64_t>, num_counters> counters {};
+    std::array<std::atomic<std::int64_t>, num_phases> phase_nanoseconds {};
+    std::array<std::atomic<std::uint64_t>, num_phases> phase_calls {};
+
+    std::string command;
+    Clock::time_point command_start;
+    Clock::duration command_duration {};
+    bool has_command = false;
+
+    std::atomic<bool> tracing = false;
+    std::mutex trace_mutex;
+    std::vector<TraceEvent> trace;
+
+    // Small, stable ids for the threads of a trace.
+    static std::uint32_t thread_id()
+    {
+        static std::atomic<std::uint32_t> next_id = 0;
+        thread_local const std::uint32_t id = next_id++;
+        return id;
+    }
+
+    void record(std::string name, Clock::time_point start, Clock::duration duration)
+    {
+        std::scoped_lock lock { trace_mutex };
+        trace.push_back({ std::move(name), thread_id(), start, duration });
+    }
+
+    static double to_ms(std::int64_t nanoseconds)
+    {
+        return nanoseconds / 1e6;
+    }
+
+    static void write_json_string(std::ostream& out, std::string_view str)
+    {
+        out << '"';
+        for (char c : str)
+        {
+            if (c == '"' or c == '\\')
+                out << '\\';
+            out << c;
+        }
+        out << '"';
+    }
+
+public:
+
+    static constexpr std::string_view phase_name(ScanPhase phase)
+    {
+        switch (phase)
+        {
+            case ScanPhase::regions: return "regions";
+            case ScanPhase::scan: return "scan";
+            case ScanPhase::read: return "read";
+            case ScanPhase::compare: return "compare";
+            case ScanPhase::filter: return "filter";
+            case ScanPhase::merge: return "merge";
+        }
+        return "";
+    }
+
+    static constexpr std::string_view counter_name(ScanCounter counter)
+    {
+        switch (counter)
+        {
+            case ScanCounter::bytes_requested: return "bytes_requested";
+            case ScanCounter::bytes_read: return "bytes_read";
+            case ScanCounter::bytes_zero: return "bytes_zero";
+            case ScanCounter::read_calls: return "read_calls";
+            case ScanCounter::read_failures: return "read_failures";
+            case ScanCounter::regions_visited: return "regions_visited";
+            case ScanCounter::regions_skipped: return "regions_skipped";
+            case ScanCounter::windows: return "windows";
+            case ScanCounter::windows_unreadable: return "windows_unreadable";
+            case ScanCounter::matches: return "matches";
+        }
+        return "";
+    }
+
+    // Times a phase from construction to stop or destruction, whichever comes first.
+    class Timer
+    {
+        ScanStats& stats;
+        ScanPhase phase;
+        Clock::time_point start = Clock::now();
+        bool running = true;
+
+    public:
+
+        Timer(ScanStats& stats, ScanPhase phase)
+            :   stats(stats), phase(phase)
+        {}
+
+        Timer(const Timer& copy) = delete;
+        Timer& operator=(const Timer& copy) = delete;
+
+        ~Timer()
+        {
+            stop();
+        }
+
+        void stop()
+        {
+            if (!running)
+                return;
+            running = false;
+
+            const Clock::duration duration = Clock::now() - start;
+            const auto index = static_cast<std::size_t>(phase);
+            stats.phase_nanoseconds[index].fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), std::memory_order_relaxed);
+            stats.phase_calls[index].fetch_add(1, std::memory_order_relaxed);
+            if (stats.tracing.load(std::memory_order_relaxed))
+                stats.record(std::string{ phase_name(phase) }, start, duration);
+        }
+    };
+
+    [[nodiscard]]
+    Timer time(ScanPhase phase)
+    {
+        return { *this, phase };
+    }
+
+    void add(ScanCounter counter, std::uint64_t n = 1)
+    {
+        counters[static_cast<std::size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    std::uint64_t get(ScanCounter counter) const
+    {
+        return counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    std::int64_t get_nanoseconds(ScanPhase phase) const
+    {
+        return phase_nanoseconds[static_cast<std::size_t>(phase)].load(std::memory_order_relaxed);
+    }
+
+    // Records phase events for write_trace from now on, or stops.
+    void set_tracing(bool on)
+    {
+        tracing = on;
+    }
+
+    bool is_tracing() const
+    {
+        return tracing;
+    }
+
+    // Clears the counters, timers and trace of the previous command. Must not overlap a scan.
+    void begin_command(std::string_view name)
+    {
+        for (auto& counter : counters)
+            counter.store(0, std::memory_order_relaxed);
+        for (std::size_t i = 0; i < num_phases; ++i)
+        {
+            phase_nanoseconds[i].store(0, std::memory_order_relaxed);
+            phase_calls[i].store(0, std::memory_order_relaxed);
+        }
+        {
+            std::scoped_lock lock { trace_mutex };
+            trace.clear();
+        }
+
+        command = name;
+        command_start = Clock::now();
+        has_command = true;
+    }
+
+    void end_command()
+    {
+        command_duration = Clock::now() - command_start;
+        if (tracing)
+            record(command, command_start, command_duration);
+    }
+
+    // The last command's time per phase and counters. Time outside of the wall time phases (regions, scan, filter,
+    // merge) went to the command itself: parsing, single reads and printing.
+    void write_report(std::ostream& out) const
+    {
+        if (!has_command)
+        {
+            out << "No command has run yet.\n";
+            return;
+        }
+
+        const std::int64_t total = std::chrono::duration_cast<std::chrono::nanoseconds>(command_duration).count();
+        std::int64_t in_phases = 0;
+        for (ScanPhase phase : { ScanPhase::regions, ScanPhase::scan, ScanPhase::filter, ScanPhase::merge })
+            in_phases += get_nanoseconds(phase);
+
+        out << "Command: " << command << '\n';
+        out << std::fixed << std::setprecision(3);
+        out << "Total: " << to_ms(total) << " ms\n";
+        for (std::size_t i = 0; i < num_phases; ++i)
+        {
+            const auto phase = static_cast<ScanPhase>(i);
+            const bool thread_time = phase == ScanPhase::read or phase == ScanPhase::compare;
+            out << (thread_time ? "  " : "") << phase_name(phase) << ": " << to_ms(get_nanoseconds(phase)) << " ms";
+            out << " (" << phase_calls[i].load(std::memory_order_relaxed) << (thread_time ? " windows, summed over threads)\n" : " calls)\n");
+        }
+        out << "other (parsing, printing): " << to_ms(std::max<std::int64_t>(total - in_phases, 0)) << " ms\n";
+        out << std::defaultfloat;
+
+        for (std::size_t i = 0; i < num_counters; ++i)
+        {
+            const auto counter = static_cast<ScanCounter>(i);
+            out << counter_name(counter) << ": " << get(counter) << '\n';
+        }
+    }
+
+    // Writes the trace of the last command in the Chrome trace event format (chrome://tracing, Perfetto): one complete
+    // event per timed phase on the thread that ran it, and one for the whole command carrying the counters.
+    void write_trace(std::ostream& out)
+    {
+        std::scoped_lock lock { trace_mutex };
+        auto micros = [&](Clock::duration duration)
+        {
+            return std::chrono::duration<double, std::micro>(duration).count();
+        };
+
+        out << std::fixed << std::setprecision(3);
+        out << "{\"traceEvents\":[\n";
+        for (std::size_t i = 0; i < trace.size(); ++i)
+        {
+            const TraceEvent& event = trace[i];
+            out << "{\"name\":";
+            write_json_string(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread;
+            out << ",\"ts\":" << micros(event.start - command_start) << ",\"dur\":" << micros(event.duration);
+            if (event.name == command and event.start == command_start)
+            {
+                out << ",\"args\":{";
+                for (std::size_t c = 0; c < num_counters; ++c)
+                {
+                    out << (c ? "," : "") << '"' << counter_name(static_cast<ScanCounter>(c)) << "\":" << get(static_cast<ScanCounter>(c));
+                }
+                out << '}';
+            }
+            out << '}' << (i + 1 < trace.size() ? "," : "") << '\n';
+        }
+        out << "],\"displayTimeUnit\":\"ms\"}\n";
+        out << std::defaultfloat;
+    }
+};
+
+#endif //SCANNER_SCANSTATS_H
@@ -1,211 +1,1052 @@
 #ifndef SCANNER_SCANNER_H
 #define SCANNER_SCANNER_H
 
-#include <windows.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <iterator>
+#include <cmath>
+#include <cstring>
+#include <functional>
 #include <string>
 #include <optional>
 #include <vector>
 #include <memory>
 #include <span>
-#include <unordered_map>
-#include <psapi.h>
+#include <unordered_set>
 #include "AddressRange.h"
+#include "BufferArena.h"
+#include "CandidateSet.h"
+#include "CoreFile.h"
+#include "PointerIndex.h"
+#include "PointerPaths.h"
+#include "RegionMap.h"
+#include "ScanControl.h"
+#include "ScanStats.h"
+#include "Snapshot.h"
+#include "SnapshotFile.h"
+#include "CompareKernels.h"
+#include "MemorySource.h"
+#include "StringSearch.h"
+#include "SignatureSearch.h"
+#include "StructPattern.h"
+#include "ThreadPool.h"
 #include "Value.h"
+#include "ValuePredicate.h"
 #include <limits>
-#include <tlhelp32.h>
+
+// How a value must have changed since the previous step of a where chain to be kept.
+enum class ChangeFilter
+{
+    increased,
+    decreased,
+    unchanged,
+    changed,
+    changed_by,
+};
+
+// One type's share of a where chain searched as several types at once.
+struct TypedCandidates
+{
+    Value val; // the chain's current value as this type, which also tags the candidates' type.
+    CandidateSet offsets;
+};
 
 class Scanner
 {
-    std::string process_name;
-    DWORD process_id;
-    HANDLE process = nullptr;
-    bool bit64;
+    std::unique_ptr<MemorySource> memory;
+    std::unique_ptr<ThreadPool> pool;
+    std::unique_ptr<BufferArena> arena = std::make_unique<BufferArena>();
+    std::vector<std::unique_ptr<AsyncReader>> readers; // one per pool thread; empty if the source only reads synchronously.
+    std::unique_ptr<ScanStats> stats = std::make_unique<ScanStats>();
+    std::unique_ptr<ScanControl> control = std::make_unique<ScanControl>();
 
     std::uintptr_t base_address;
-    std::vector<AddressRange> ro_pages;
-    std::vector<std::uintptr_t> cur_where_offsets; // offsets of the current where chain.
+    RegionMap regions;
+    CandidateSet cur_where_offsets; // offsets of the current where chain.
     Value cur_where_val;
+    std::vector<TypedCandidates> typed_where; // the current where chain if it was started for several types, see where_vals.
+    std::optional<std::vector<SnapshotBlock>> snapshot; // previous values per candidate block, if the chain started unknown.
+    std::optional<PointerIndex> pointer_index;
+    bool track_dirty = false;
+    std::optional<std::uint64_t> dirty_baseline; // region map generation when soft dirty bits were last reset.
+    std::uint64_t dirty_baseline_cancellations = 0; // control's count then, see dirty_pages_known.
 
     [[nodiscard]]
-    bool read_mem_safe(LPVOID buf, LPCVOID from, std::size_t to_read) const
+    bool read_mem_safe(void* buf, std::uintptr_t from, std::size_t to_read) const
     {
-        SIZE_T bytes_read;
+        const bool ok = memory->read(buf, from, to_read);
+        stats->add(ScanCounter::read_calls);
+        stats->add(ScanCounter::bytes_requested, to_read);
+        stats->add(ok ? ScanCounter::bytes_read : ScanCounter::read_failures, ok ? to_read : 1);
+        return ok;
+    }
 
-        if (ReadProcessMemory(process, from, buf, to_read, &bytes_read) == 0)
+    // memory->read_batch, counted as one read call with a failure per failed request.
+    void read_batch(std::span<ReadRequest> requests) const
+    {
+        memory->read_batch(requests);
+
+        std::size_t requested = 0;
+        std::size_t read = 0;
+        std::size_t failures = 0;
+        for (const ReadRequest& request : requests)
         {
-            // func failed.
-            return false;
+            requested += request.size;
+            read += request.ok ? request.size : 0;
+            failures += !request.ok;
         }
+        stats->add(ScanCounter::read_calls);
+        stats->add(ScanCounter::bytes_requested, requested);
+        stats->add(ScanCounter::bytes_read, read);
+        stats->add(ScanCounter::read_failures, failures);
+    }
 
-        return to_read == bytes_read;
+    // memory->view, counted as a read without a call.
+    std::span<const std::byte> view(std::uintptr_t from, std::size_t size) const
+    {
+        std::span<const std::byte> data = memory->view(from, size);
+        stats->add(ScanCounter::bytes_requested, size);
+        stats->add(data.empty() ? ScanCounter::read_failures : ScanCounter::bytes_read, data.empty() ? 1 : size);
+        return data;
     }
 
-    template <typename T>
-    std::vector<std::uintptr_t> where_val_internal(T val) const
+    // Reads a range of one region, leaving out pages the region map knows to be untouched (they are zero filled instead).
+    [[nodiscard]]
+    bool read_window(std::byte* buf, std::uintptr_t from, std::size_t to_read) const
     {
-        std::vector<std::uintptr_t> offsets;
+        bool ok = true;
+        regions.for_each_page_run(from, to_read, [&](std::uintptr_t address, std::size_t size, bool zero)
+        {
+            std::byte* dest = buf + (address - from);
+            if (zero)
+            {
+                std::memset(dest, 0, size);
+                stats->add(ScanCounter::bytes_zero, size);
+            }
+            else if (ok)
+                ok = read_mem_safe(dest, address, size);
+        });
+        return ok;
+    }
+
+    // The bytes of [from, from + size) of one region: a view of the source's own memory where it has one (no copy),
+    // otherwise read into 'buf'. Empty if unreadable. Lease buffers with lease_window.
+    std::span<const std::byte> load_window(const BufferArena::Lease& buf, std::uintptr_t from, std::size_t size) const
+    {
+        if (memory->has_views())
+            return view(from, size);
+        if (!read_window(buf.data(), from, size))
+            return {};
+        return { buf.data(), size };
+    }
+
+    BufferArena::Lease lease_window(std::size_t size) const
+    {
+        return arena->acquire(memory->has_views() ? 0 : size);
+    }
+
+    // Refreshes the region map and the page residency of its regions before a scan over all of memory.
+    void prepare_full_scan()
+    {
+        ScanStats::Timer timer = stats->time(ScanPhase::regions);
+        regions.refresh(*memory);
+        regions.refresh_residency(*memory);
+    }
+
+    // Reads a T at every offset in one batched read per block of offsets and calls on_read(offset, std::optional<T>).
+    template <typename T, typename F>
+    void read_each(std::span<const std::uintptr_t> offsets, F&& on_read) const
+    {
+        constexpr std::size_t block_size = 16384;
+        std::vector<T> vals;
+        std::vector<ReadRequest> requests;
 
-        for (const auto page : get_all_pages())
+        for (std::size_t block_start = 0; block_start < offsets.size(); block_start += block_size)
         {
-            constexpr auto element_bytes = sizeof(T);
-            auto num_elements = (page.size() / element_bytes);
-            std::unique_ptr<T[]> buf = read_array<T>(page.start() - base_address, num_elements);
+            auto block = offsets.subspan(block_start, std::min(block_size, offsets.size() - block_start));
+            vals.resize(block.size());
+            requests.clear();
+            for (std::size_t i = 0; i < block.size(); ++i)
+            {
+                requests.push_back({ base_address + block[i], &vals[i], sizeof(T) });
+            }
 
-            if (!buf)
-                continue;
+            read_batch(requests);
 
-            for (std::size_t i = 0; i < num_elements; ++i)
+            for (std::size_t i = 0; i < block.size(); ++i)
             {
-                auto page_address = page.get_address_offset(i * element_bytes);
-                T read_val = buf[i];
+                on_read(block[i], requests[i].ok ? std::optional<T>{ vals[i] } : std::nullopt);
+            }
+        }
+    }
 
-                if (eq_vals(read_val, val))
+    // A fixed size window of one region, scanned as a single task of a parallel scan.
+    // 'readable' is the number of bytes from the window start to the end of its region.
+    struct ScanWindow
+    {
+        AddressRange range;
+        std::size_t readable;
+    };
+
+    static constexpr std::size_t min_window_size = 1024 * 1024;
+    static constexpr std::size_t max_window_size = 16 * 1024 * 1024;
+    std::size_t window_size = 4 * 1024 * 1024; // page multiple, so a multiple of every scanned type's size.
+
+    std::vector<ScanWindow> split_into_windows(std::span<const AddressRange> pages) const
+    {
+        std::vector<ScanWindow> windows;
+        for (const AddressRange& page : pages)
+        {
+            for (std::size_t window_start = 0; window_start < page.size(); window_start += window_size)
+            {
+                auto window_bytes = std::min(window_size, page.size() - window_start);
+                windows.push_back({ { page.get_address_offset(window_start), window_bytes }, page.size() - window_start });
+            }
+        }
+        return windows;
+    }
+
+    // split_into_windows for a scan over 'pages' out of the region map, counting the regions visited and left out.
+    std::vector<ScanWindow> plan_scan(std::span<const AddressRange> pages) const
+    {
+        stats->add(ScanCounter::regions_visited, pages.size());
+        stats->add(ScanCounter::regions_skipped, regions.get_regions().size() - std::min(pages.size(), regions.get_regions().size()));
+        return split_into_windows(pages);
+    }
+
+    // Bytes to read for a window: the window plus up to 'overlap' bytes of the rest of its region.
+    static std::size_t window_read_size(const ScanWindow& window, std::size_t overlap)
+    {
+        return std::min(window.range.size() + overlap, window.readable);
+    }
+
+    // Loads a window with its overlap into 'buf' (of at least window_read_size bytes). The overlap may run into a bad
+    // page of the next window, in which case the window is read again without it. Empty if unreadable.
+    std::span<const std::byte> load_window_overlapping(std::byte* buf, const ScanWindow& window, std::size_t overlap) const
+    {
+        const std::size_t read_bytes = window_read_size(window, overlap);
+        if (memory->has_views())
+        {
+            std::span<const std::byte> data = view(window.range.start(), read_bytes);
+            return data.empty() and read_bytes != window.range.size() ? view(window.range.start(), window.range.size()) : data;
+        }
+
+        if (read_window(buf, window.range.start(), read_bytes))
+            return { buf, read_bytes };
+        if (read_bytes != window.range.size() and read_window(buf, window.range.start(), window.range.size()))
+            return { buf, window.range.size() };
+        return {};
+    }
+
+    // Calls on_window(window_index, data) for every readable window, in parallel, with data holding the window and up
+    // to 'overlap' bytes past it (see load_window_overlapping).
+    // With async readers each pool thread claims windows in order and keeps the reads of the next two in flight while
+    // on_window runs on the current one (three buffers per thread), so a scan takes about as long as the slower of
+    // reading and comparing rather than their sum. Otherwise every window is read and then scanned by one task.
+    // Windows are reported to the scan control as they finish; once cancelled, no new window is started and
+    // ScanCancelled is thrown when the ones in progress are done.
+    template <typename F>
+    void for_each_window(std::span<const ScanWindow> windows, std::size_t overlap, F&& on_window) const
+    {
+        ScanStats::Timer timer = stats->time(ScanPhase::scan);
+        stats->add(ScanCounter::windows, windows.size());
+
+        std::uint64_t total_bytes = 0;
+        for (const ScanWindow& window : windows)
+        {
+            total_bytes += window.range.size();
+        }
+        control->add_work(total_bytes);
+
+        auto compare = [&](std::size_t window_index, std::span<const std::byte> data)
+        {
+            if (data.empty())
+            {
+                stats->add(ScanCounter::windows_unreadable);
+                return;
+            }
+            ScanStats::Timer compare_timer = stats->time(ScanPhase::compare);
+            on_window(window_index, data);
+        };
+
+        if (readers.empty())
+        {
+            pool->parallel_for(windows.size(), [&](std::size_t window_index)
+            {
+                if (control->is_cancelled())
+                    return;
+
+                const ScanWindow& window = windows[window_index];
+                BufferArena::Lease buf = lease_window(window_read_size(window, overlap));
+                ScanStats::Timer read_timer = stats->time(ScanPhase::read);
+                std::span<const std::byte> data = load_window_overlapping(buf.data(), window, overlap);
+                read_timer.stop();
+                compare(window_index, data);
+                control->finish_work(window.range.size());
+            });
+            control->throw_if_cancelled();
+            return;
+        }
+
+        constexpr std::size_t depth = 3;
+        std::size_t slot_bytes = 0;
+        for (const ScanWindow& window : windows)
+        {
+            slot_bytes = std::max(slot_bytes, window_read_size(window, overlap));
+        }
+        slot_bytes = (slot_bytes + BufferArena::alignment - 1) / BufferArena::alignment * BufferArena::alignment;
+
+        std::atomic<std::size_t> next_window = 0;
+        pool->parallel_for(std::min<std::size_t>(readers.size(), windows.size()), [&](std::size_t lane)
+        {
+            AsyncReader& reader = *readers[lane];
+            BufferArena::Lease buf = arena->acquire(depth * slot_bytes);
+            std::array<std::size_t, depth> slot_window;
+            std::array<bool, depth> slot_active {};
+            std::array<std::size_t, depth> slot_requested {};
+            std::vector<AsyncReader::Read> reads;
+
+            // Claims the next window and starts reading it into the slot; zero pages are filled right away.
+            auto start = [&](std::size_t slot)
+            {
+                const std::size_t window_index = control->is_cancelled() ? windows.size() : next_window++;
+                slot_active[slot] = window_index < windows.size();
+                if (!slot_active[slot])
+                    return;
+
+                slot_window[slot] = window_index;
+                const ScanWindow& window = windows[window_index];
+                std::byte* dest = buf.data() + slot * slot_bytes;
+                reads.clear();
+                std::size_t requested = 0;
+                regions.for_each_page_run(window.range.start(), window_read_size(window, overlap), [&](std::uintptr_t address, std::size_t size, bool zero)
+                {
+                    if (zero)
+                    {
+                        std::memset(dest + (address - window.range.start()), 0, size);
+                        stats->add(ScanCounter::bytes_zero, size);
+                    }
+                    else
+                    {
+                        reads.push_back({ dest + (address - window.range.start()), address, size });
+                        requested += size;
+                    }
+                });
+                reader.submit(slot, reads);
+                slot_requested[slot] = requested;
+                stats->add(ScanCounter::read_calls, reads.size());
+                stats->add(ScanCounter::bytes_requested, requested);
+            };
+
+            try
+            {
+                for (std::size_t slot = 0; slot < depth; ++slot)
                 {
-                    offsets.push_back(page_address - base_address);
+                    start(slot);
+                }
+
+                for (std::size_t slot = 0; slot_active[slot]; slot = (slot + 1) % depth)
+                {
+                    const ScanWindow& window = windows[slot_window[slot]];
+                    std::byte* data = buf.data() + slot * slot_bytes;
+                    std::span<const std::byte> loaded { data, window_read_size(window, overlap) };
+                    ScanStats::Timer read_timer = stats->time(ScanPhase::read);
+                    if (reader.wait(slot))
+                    {
+                        stats->add(ScanCounter::bytes_read, slot_requested[slot]);
+                    }
+                    else
+                    {
+                        stats->add(ScanCounter::read_failures);
+                        loaded = load_window_overlapping(data, window, overlap);
+                    }
+                    read_timer.stop();
+                    compare(slot_window[slot], loaded);
+                    control->finish_work(window.range.size());
+                    start(slot);
                 }
             }
+            catch (...)
+            {
+                // The reads still in flight target the buffer about to go back to the arena.
+                reader.drain();
+                throw;
+            }
+        });
+        control->throw_if_cancelled();
+    }
+
+    // Streams every region through arena buffers one window at a time, in parallel.
+    // Each window is read together with the first 'overlap' bytes of the next so matches straddling the boundary
+    // are seen; scan_window(window_offset, data, window_bytes, outs) reports matches into one output per stride and
+    // must only report matches starting in the first window_bytes of data, in increasing order. An unreadable window is
+    // skipped without affecting the rest of its region.
+    // Returns one candidate set per stride, holding that output's offsets as one block per window, in the order of
+    // 'pages'.
+    template <typename F>
+    std::vector<CandidateSet> scan_windows(std::span<const AddressRange> pages, std::span<const std::uint32_t> strides, std::size_t overlap, F&& scan_window) const
+    {
+        const std::vector<ScanWindow> windows = plan_scan(pages);
+        std::vector<std::vector<CandidateSet>> results(strides.size());
+        for (std::size_t i = 0; i < strides.size(); ++i)
+        {
+            results[i].assign(windows.size(), CandidateSet{ strides[i] });
         }
 
-        return offsets;
+        for_each_window(windows, overlap, [&](std::size_t window_index, std::span<const std::byte> data)
+        {
+            const ScanWindow& window = windows[window_index];
+            const std::uintptr_t window_offset = window.range.start() - base_address;
+
+            std::vector<std::vector<std::uintptr_t>> offsets(strides.size());
+            scan_window(window_offset, data, window.range.size(), std::span<std::vector<std::uintptr_t>>{ offsets });
+            for (std::size_t i = 0; i < strides.size(); ++i)
+            {
+                results[i][window_index].append_block(window_offset, static_cast<std::uint32_t>(window.range.size() / strides[i]), offsets[i]);
+                control->publish(offsets[i]);
+            }
+        });
+
+        std::vector<CandidateSet> merged;
+        for (std::size_t i = 0; i < strides.size(); ++i)
+        {
+            merged.push_back(merge_candidate_sets(strides[i], results[i]));
+        }
+        return merged;
+    }
+
+    // scan_windows over get_all_pages().
+    template <typename F>
+    std::vector<CandidateSet> scan_windows(std::span<const std::uint32_t> strides, std::size_t overlap, F&& scan_window) const
+    {
+        return scan_windows(get_all_pages(), strides, overlap, std::forward<F>(scan_window));
+    }
+
+    // scan_windows over get_all_pages() with a single output.
+    template <typename F>
+    CandidateSet scan_windows(std::uint32_t stride, std::size_t overlap, F&& scan_window) const
+    {
+        const std::uint32_t strides[] { stride };
+        return std::move(scan_windows(strides, overlap, [&](std::uintptr_t window_offset, std::span<const std::byte> data, std::size_t window_bytes, std::span<std::vector<std::uintptr_t>> outs)
+        {
+            scan_window(window_offset, data, window_bytes, outs.front());
+        }).front());
+    }
+
+    // Joins per window or per block results into one set, counted as the command's matches.
+    CandidateSet merge_candidate_sets(std::uint32_t stride, std::span<const CandidateSet> parts) const
+    {
+        ScanStats::Timer timer = stats->time(ScanPhase::merge);
+        CandidateSet merged { stride };
+        for (const CandidateSet& part : parts)
+        {
+            merged.append(part);
+        }
+        stats->add(ScanCounter::matches, merged.size());
+        return merged;
+    }
+
+    template <typename T>
+    CandidateSet where_val_internal(T val) const
+    {
+        return scan_windows(sizeof(T), 0, [val](std::uintptr_t window_offset, std::span<const std::byte> data, std::size_t window_bytes, std::vector<std::uintptr_t>& out)
+        {
+            std::span<const T> elements { reinterpret_cast<const T*>(data.data()), window_bytes / sizeof(T) };
+            CompareKernels::find_equal<T>(elements, val, window_offset, out);
+        });
+    }
+
+    // Starts a chain with every value passing 'pred' (a CompareKernels predicate). The survivors do not share one known
+    // value, so the values found are kept as the chain's snapshot, taken from the same read as the scan: whole windows
+    // where most slots match, else just the matching values.
+    template <typename T, typename Pred>
+    void where_matching_internal(const Pred& pred)
+    {
+        const std::vector<ScanWindow> windows = plan_scan(get_all_pages());
+        std::vector<CandidateSet> results(windows.size(), CandidateSet{ sizeof(T) });
+        std::vector<std::optional<SnapshotBlock>> snapshots(windows.size());
+
+        for_each_window(windows, 0, [&](std::size_t window_index, std::span<const std::byte> data)
+        {
+            const ScanWindow& window = windows[window_index];
+            const std::uintptr_t window_offset = window.range.start() - base_address;
+            const auto slots = static_cast<std::uint32_t>(window.range.size() / sizeof(T));
+            std::span<const T> elements { reinterpret_cast<const T*>(data.data()), slots };
+            std::vector<std::uintptr_t> offsets;
+            CompareKernels::find_matching(elements, pred, window_offset, offsets);
+            if (offsets.empty())
+                return;
+
+            results[window_index].append_block(window_offset, slots, offsets);
+            control->publish(offsets);
+            if (offsets.size() * 8 >= slots)
+            {
+                snapshots[window_index] = SnapshotBlock::of_block(data.first(slots * sizeof(T)));
+            }
+            else
+            {
+                std::vector<T> vals;
+                for (std::uintptr_t offset : offsets)
+                {
+                    vals.push_back(elements[(offset - window_offset) / sizeof(T)]);
+                }
+                snapshots[window_index] = SnapshotBlock::of_values(std::as_bytes(std::span<const T>{ vals }));
+            }
+        });
+
+        cur_where_offsets = merge_candidate_sets(sizeof(T), results);
+        cur_where_val = T{}; // only records the chain's type.
+        snapshot.emplace();
+        for (auto& window_snapshot : snapshots)
+        {
+            if (window_snapshot)
+                snapshot->emplace_back(std::move(*window_snapshot));
+        }
     }
 
-    std::uintptr_t scan_base_address() const
+    // A sorted group of candidate offsets close enough together to be read with one request.
+    struct CandidateRun
     {
-        const DWORD id = GetProcessId(process);
-        MODULEENTRY32 me32;
-        me32.dwSize = sizeof(MODULEENTRY32);
-        HANDLE module_snap = INVALID_HANDLE_VALUE;
-        module_snap = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE, id);
+        std::size_t first; // index of the first candidate in the run.
+        std::size_t count;
+        std::uintptr_t offset;
+        std::size_t bytes;
+    };
+
+    static constexpr std::size_t page_size = 4096;
 
-        if(module_snap == INVALID_HANDLE_VALUE)
+    // Groups candidates into runs: a run grows while the next candidate is on the same or the following page of the
+    // previous one and the run stays within one scan window.
+    template <typename T>
+    std::vector<CandidateRun> group_candidate_runs(std::span<const std::uintptr_t> candidates) const
+    {
+        std::vector<CandidateRun> runs;
+        for (std::size_t i = 0; i < candidates.size(); ++i)
+        {
+            const std::uintptr_t offset = candidates[i];
+            if (!runs.empty())
+            {
+                CandidateRun& run = runs.back();
+                const std::uintptr_t run_end = run.offset + run.bytes;
+                const bool follows = offset >= run_end - sizeof(T) + 1;
+                const bool near = (base_address + offset) / page_size <= (base_address + run_end - 1) / page_size + 1;
+                if (follows and near and offset + sizeof(T) - run.offset <= window_size)
+                {
+                    run.bytes = offset + sizeof(T) - run.offset;
+                    ++run.count;
+                    continue;
+                }
+            }
+            runs.push_back({ i, 1, offset, sizeof(T) });
+        }
+        return runs;
+    }
+
+    // Reads the current value of every candidate of one block and calls on_read(index, offset, std::optional<T>) in order.
+    // Runs of nearby candidates are re-read with one batched read and decoded from the buffer.
+    template <typename T, typename F>
+    void read_sparse(std::span<const std::uintptr_t> candidates, F&& on_read) const
+    {
+        const std::vector<CandidateRun> runs = group_candidate_runs<T>(candidates);
+
+        std::size_t total_bytes = 0;
+        for (const CandidateRun& run : runs)
         {
-            throw std::runtime_error("Could not get process module snapshot.");
+            total_bytes += run.bytes;
         }
 
-        if(!Module32First(module_snap, &me32))
+        BufferArena::Lease buf = arena->acquire(total_bytes);
+        std::vector<ReadRequest> requests;
+        std::byte* next_buf = buf.data();
+        for (const CandidateRun& run : runs)
         {
-            CloseHandle(module_snap);
-            throw std::runtime_error("Could not get first module.");
+            requests.push_back({ base_address + run.offset, next_buf, run.bytes });
+            next_buf += run.bytes;
         }
+        read_batch(requests);
 
-        std::uintptr_t base_address = 0;
-        do
+        for (std::size_t r = 0; r < runs.size(); ++r)
         {
-            if (strcmp(process_name.c_str(), me32.szModule) == 0)
+            const CandidateRun& run = runs[r];
+            auto run_candidates = candidates.subspan(run.first, run.count);
+
+            if (!requests[r].ok)
+            {
+                // Part of the run is unreadable, fall back to reading its candidates individually.
+                std::size_t index = run.first;
+                read_each<T>(run_candidates, [&](std::uintptr_t offset, std::optional<T> cur_val)
+                {
+                    on_read(index++, offset, cur_val);
+                });
+                continue;
+            }
+
+            const auto* run_bytes = static_cast<const std::byte*>(requests[r].buffer);
+            for (std::size_t i = 0; i < run_candidates.size(); ++i)
             {
-                base_address = reinterpret_cast<std::uintptr_t>(me32.modBaseAddr);
+                T cur_val;
+                std::memcpy(&cur_val, run_bytes + (run_candidates[i] - run.offset), sizeof(T));
+                on_read(run.first + i, run_candidates[i], std::optional<T>{ cur_val });
             }
-        } while(Module32Next(module_snap, &me32) and base_address == 0);
+        }
+    }
 
-        CloseHandle(module_snap);
+    // Keeps the candidates of one block whose current value passes 'pred' (a CompareKernels predicate), dropping
+    // unreadable ones.
+    template <typename T, typename Pred>
+    void filter_sparse(std::span<const std::uintptr_t> candidates, const Pred& pred, std::vector<std::uintptr_t>& out) const
+    {
+        read_sparse<T>(candidates, [&](std::size_t, std::uintptr_t offset, std::optional<T> cur_val)
+        {
+            if (cur_val and pred(*cur_val))
+                out.push_back(offset);
+        });
+    }
 
-        if (base_address == 0)
+    // Starts a new dirty tracking interval before a chain step reads memory. Resetting before reading (instead of after)
+    // means a write racing with the step's reads is seen as dirty by the next step rather than lost.
+    void reset_dirty_tracking()
+    {
+        dirty_baseline.reset();
+        if (track_dirty and memory->reset_dirty_pages())
         {
-            throw std::runtime_error("Could not find base address.");
+            dirty_baseline = regions.get_generation();
+            dirty_baseline_cancellations = control->get_cancellations();
         }
+    }
 
-        return base_address;
+    // Whether the pages written since the previous chain step can be known: tracking is on, had a baseline, the memory
+    // map did not change since then (pages of a remapped region would read as clean) and no step was cancelled since
+    // (it reset the dirty bits but left the chain as it was).
+    bool dirty_pages_known()
+    {
+        regions.refresh(*memory);
+        return track_dirty and dirty_baseline == regions.get_generation() and dirty_baseline_cancellations == control->get_cancellations();
     }
 
-public:
+    // The pages of every block of 'candidates' written since the previous chain step.
+    std::vector<DirtyPages> scan_dirty_blocks(const CandidateSet& candidates) const
+    {
+        const std::uint32_t stride = candidates.get_stride();
+        auto blocks = candidates.get_blocks();
+        std::vector<DirtyPages> dirty(blocks.size());
+        pool->parallel_for(blocks.size(), [&](std::size_t block_index)
+        {
+            const CandidateSet::Block& block = blocks[block_index];
+            if (!memory->scan_dirty_pages({ base_address + block.start, block.end(stride) - block.start }, dirty[block_index]))
+                dirty[block_index] = {};
+        });
+        return dirty;
+    }
 
-    Scanner(const std::string& window_name)
+    // The pages of every candidate block written since the previous chain step, then resets tracking for the next one.
+    // Empty (every page dirty) unless dirty_pages_known.
+    std::vector<DirtyPages> begin_tracked_step()
     {
-        HWND window = FindWindow(NULL, window_name.c_str());
+        std::vector<DirtyPages> dirty;
+        if (dirty_pages_known())
+            dirty = scan_dirty_blocks(cur_where_offsets);
+
+        reset_dirty_tracking();
+        return dirty;
+    }
 
-        if (window)
+    // Splits a block's candidates into those on pages written since the previous step and those on clean pages.
+    template <typename T>
+    void split_by_dirty(const DirtyPages& dirty, std::span<const std::uintptr_t> offsets, std::vector<std::uintptr_t>& dirty_offsets, std::vector<std::uintptr_t>& clean_offsets) const
+    {
+        for (std::uintptr_t offset : offsets)
         {
-            DWORD process_id;
-            GetWindowThreadProcessId(window, &process_id);
-            this->process_id = process_id;
+            (dirty.is_dirty(base_address + offset, sizeof(T)) ? dirty_offsets : clean_offsets).push_back(offset);
+        }
+    }
 
-            process = OpenProcess( PROCESS_VM_READ | PROCESS_QUERY_INFORMATION , FALSE, process_id );
-            if (!process)
-                throw std::runtime_error("Could not open process.");
+    // Reports the bytes spanned by the blocks of a candidate set to the scan control as the work of filtering it.
+    void add_filter_work(const CandidateSet& candidates) const
+    {
+        std::uint64_t total_bytes = 0;
+        for (const CandidateSet::Block& block : candidates.get_blocks())
+        {
+            total_bytes += static_cast<std::uint64_t>(block.slots) * candidates.get_stride();
+        }
+        control->add_work(total_bytes);
+    }
 
+    // Filters a candidate set block by block in parallel, see filter_sparse.
+    // Dense blocks (whole or bitmap encoded) are re-scanned in full with the vectorized compare kernel and the
+    // result intersected with the candidates (for a negated predicate, the matches of the inner one are subtracted
+    // instead); sparse blocks re-read only the runs around their candidates.
+    // With dirty pages and a clean_val (the value every candidate held at the previous step), candidates on clean pages
+    // are decided without reading them.
+    // Throws ScanCancelled if cancelled, without starting the blocks left.
+    template <typename T, typename Pred>
+    CandidateSet filter_candidates(const CandidateSet& candidates, const Pred& pred, std::span<const DirtyPages> dirty = {}, std::optional<T> clean_val = {}) const
+    {
+        const std::uint32_t stride = candidates.get_stride();
+        auto blocks = candidates.get_blocks();
+        std::vector<CandidateSet> results(blocks.size(), CandidateSet{ stride });
+        add_filter_work(candidates);
 
-            constexpr int name_max_size = 256;
-            char process_name_buffer[name_max_size];
-            auto name_str_size = GetModuleBaseName(process, NULL, process_name_buffer, name_max_size);
+        ScanStats::Timer timer = stats->time(ScanPhase::filter);
+        pool->parallel_for(blocks.size(), [&](std::size_t block_index)
+        {
+            if (control->is_cancelled())
+                return;
 
-            if (name_str_size == 0)
-                throw std::runtime_error("Could not read process name.");
+            const CandidateSet::Block& block = blocks[block_index];
+            std::vector<std::uintptr_t> offsets;
+            candidates.decode_block(block_index, offsets);
 
-            process_name = { process_name_buffer, name_str_size };
+            std::vector<std::uintptr_t> kept;
+            if (clean_val and !dirty.empty() and dirty[block_index].page_size != 0)
+            {
+                std::vector<std::uintptr_t> dirty_offsets, clean_offsets, dirty_kept;
+                split_by_dirty<T>(dirty[block_index], offsets, dirty_offsets, clean_offsets);
+                filter_sparse<T>(std::span<const std::uintptr_t>{ dirty_offsets }, pred, dirty_kept);
 
-            BOOL wow64Ret;
-            IsWow64Process(process, &wow64Ret);
-            if (wow64Ret)
+                if (pred(*clean_val))
+                    std::merge(dirty_kept.begin(), dirty_kept.end(), clean_offsets.begin(), clean_offsets.end(), std::back_inserter(kept));
+                else
+                    kept = std::move(dirty_kept);
+
+                results[block_index].append_block(block.start, block.slots, kept);
+                control->publish(kept);
+                control->finish_work(static_cast<std::uint64_t>(block.slots) * stride);
+                return;
+            }
+
+            bool dense = block.encoding != CandidateSet::Encoding::deltas and stride == sizeof(T);
+            if (dense)
             {
-                bit64 = false; // returns true if process is 32 bit on a 64bit system.
+                const std::size_t block_bytes = static_cast<std::size_t>(block.slots) * stride;
+                BufferArena::Lease buf = arena->acquire(block_bytes);
+                dense = read_mem_safe(buf.data(), base_address + block.start, block_bytes);
+
+                if (dense)
+                {
+                    std::span<const T> elements { reinterpret_cast<const T*>(buf.data()), block.slots };
+                    std::vector<std::uintptr_t> matching_offsets;
+                    if constexpr(CompareKernels::is_negation<Pred>)
+                    {
+                        CompareKernels::find_matching(elements, pred.pred, block.start, matching_offsets);
+                        std::set_difference(offsets.begin(), offsets.end(), matching_offsets.begin(), matching_offsets.end(), std::back_inserter(kept));
+                    }
+                    else
+                    {
+                        CompareKernels::find_matching(elements, pred, block.start, matching_offsets);
+                        std::set_intersection(offsets.begin(), offsets.end(), matching_offsets.begin(), matching_offsets.end(), std::back_inserter(kept));
+                    }
+                }
             }
-            else
+
+            if (!dense)
             {
-                // process is same bit as os.
-                SYSTEM_INFO sys_info;
-                GetNativeSystemInfo(&sys_info);
-                bit64 = sys_info.wProcessorArchitecture == PROCESSOR_ARCHITECTURE_AMD64 or
-                        sys_info.wProcessorArchitecture == PROCESSOR_ARCHITECTURE_ARM64 or
-                        sys_info.wProcessorArchitecture == PROCESSOR_ARCHITECTURE_IA64;
+                filter_sparse<T>(std::span<const std::uintptr_t>{ offsets }, pred, kept);
             }
 
+            results[block_index].append_block(block.start, block.slots, kept);
+            control->publish(kept);
+            control->finish_work(static_cast<std::uint64_t>(block.slots) * stride);
+        });
+        timer.stop();
+
+        control->throw_if_cancelled();
+        return merge_candidate_sets(stride, results);
+    }
+
+    // Filters every type of the typed chain against its value in 'vals', keeping candidates equal to it (keep_equal) or
+    // different from it (!keep_equal). Integer candidates take the value of their width, of their own type if 'vals'
+    // has it, else of the other sign: the bits compared are the same, and a value may parse as only one of the two
+    // (a chain found as uint8 200 continues with became 100, parsed as int8). Types without a value in 'vals' and
+    // types left without candidates drop out of the chain.
+    void filter_typed_chain(std::span<const Value> vals, bool keep_equal)
+    {
+        std::vector<std::vector<DirtyPages>> dirty(typed_where.size());
+        if (dirty_pages_known())
+        {
+            for (std::size_t i = 0; i < typed_where.size(); ++i)
+            {
+                dirty[i] = scan_dirty_blocks(typed_where[i].offsets);
+            }
         }
-        else
+        reset_dirty_tracking();
+
+        auto same_width = [](const Value& a, const Value& b)
+        {
+            return a.visit([&](auto x)
+            {
+                return b.visit([&](auto y)
+                {
+                    return std::is_integral_v<decltype(x)> and std::is_integral_v<decltype(y)> and sizeof x == sizeof y;
+                });
+            });
+        };
+
+        std::vector<TypedCandidates> kept;
+        for (std::size_t i = 0; i < typed_where.size(); ++i)
         {
-            throw std::runtime_error("Could not find process (Is it running?).");
+            const TypedCandidates& typed = typed_where[i];
+            auto val = std::find_if(vals.begin(), vals.end(), [&](const Value& v){ return v.type_index() == typed.val.type_index(); });
+            if (val == vals.end())
+                val = std::find_if(vals.begin(), vals.end(), [&](const Value& v){ return same_width(v, typed.val); });
+            if (val == vals.end())
+                continue;
+
+            val->visit([&](auto v)
+            {
+                using T = decltype(v);
+                // Floats were only matched within a tolerance, so candidates on clean pages need not hold exactly val.
+                std::optional<T> clean_val;
+                if constexpr (std::is_integral_v<T>)
+                {
+                    clean_val = typed.val.visit([](auto prev)
+                    {
+                        T bits {};
+                        if constexpr (sizeof prev == sizeof bits)
+                            std::memcpy(&bits, &prev, sizeof bits);
+                        return bits;
+                    });
+                }
+
+                CandidateSet offsets = keep_equal
+                    ? filter_candidates<T>(typed.offsets, CompareKernels::Equal<T>{ v }, dirty[i], clean_val)
+                    : filter_candidates<T>(typed.offsets, CompareKernels::Not<CompareKernels::Equal<T>>{ { v } }, dirty[i], clean_val);
+                if (!offsets.empty())
+                    kept.push_back({ *val, std::move(offsets) });
+            });
         }
+        typed_where = std::move(kept);
+    }
 
-        ro_pages = scan_pages(PAGE_READONLY);
-        base_address = scan_base_address();
+    // Calls f with the test of a change filter, passes(prev, cur), as its own function object type.
+    template <typename T, typename F>
+    static void with_change_test(ChangeFilter filter, T by, F&& f)
+    {
+        using CompareKernels::values_equal;
+        switch (filter)
+        {
+            case ChangeFilter::increased: return f([](T prev, T cur){ return cur > prev and !values_equal(cur, prev); });
+            case ChangeFilter::decreased: return f([](T prev, T cur){ return cur < prev and !values_equal(cur, prev); });
+            case ChangeFilter::unchanged: return f([](T prev, T cur){ return values_equal(cur, prev); });
+            case ChangeFilter::changed: return f([](T prev, T cur){ return !values_equal(cur, prev); });
+            case ChangeFilter::changed_by: return f([by](T prev, T cur){ return values_equal(static_cast<T>(cur - prev), by); });
+        }
     }
 
+    // Filters the chain by testing every candidate's current value against its previous one with passes(prev, cur),
+    // the previous value taken from the snapshot or, for a chain started with a known value, from cur_where_val.
+    // Blocks are processed in parallel, one at a time: the block's snapshot is decompressed, its current values are
+    // read (whole block if dense, runs if sparse) and the survivors' current values become the block's new snapshot.
+    // With dirty tracking, candidates on clean pages keep their previous value without being read.
+    // A cancelled filter throws ScanCancelled and leaves the chain as it was.
+    template <typename T, typename F>
+    void filter_changes(F&& passes)
+    {
+        const std::vector<DirtyPages> dirty = begin_tracked_step();
+        // Float chains started with a known value only know the previous value approximately.
+        const bool clean_known = snapshot or std::is_integral_v<T>;
+
+        const std::uint32_t stride = cur_where_offsets.get_stride();
+        auto blocks = cur_where_offsets.get_blocks();
+        std::vector<CandidateSet> results(blocks.size(), CandidateSet{ stride });
+        std::vector<std::optional<SnapshotBlock>> snapshots(blocks.size());
+        add_filter_work(cur_where_offsets);
+
+        ScanStats::Timer timer = stats->time(ScanPhase::filter);
+        pool->parallel_for(blocks.size(), [&](std::size_t block_index)
+        {
+            if (control->is_cancelled())
+                return;
+
+            const CandidateSet::Block& block = blocks[block_index];
+            const std::size_t block_bytes = static_cast<std::size_t>(block.slots) * stride;
+            std::vector<std::uintptr_t> offsets;
+            cur_where_offsets.decode_block(block_index, offsets);
+
+            const SnapshotBlock* prev_snapshot = snapshot ? &(*snapshot)[block_index] : nullptr;
+            BufferArena::Lease prev_buf = arena->acquire(prev_snapshot ? prev_snapshot->size() : 0);
+            if (prev_snapshot)
+            {
+                prev_snapshot->restore({ prev_buf.data(), prev_snapshot->size() });
+            }
+
+            auto prev_val = [&](std::size_t index, std::uintptr_t offset)
+            {
+                if (!prev_snapshot)
+                    return cur_where_val.get<T>();
+
+                T val;
+                std::size_t at = prev_snapshot->get_layout() == SnapshotBlock::Layout::block_bytes ? offset - block.start : index * sizeof(T);
+                std::memcpy(&val, prev_buf.data() + at, sizeof(T));
+                return val;
+            };
+
+            std::vector<std::uintptr_t> kept;
+            std::vector<T> kept_vals;
+            auto check = [&](std::size_t index, std::uintptr_t offset, std::optional<T> cur_val)
+            {
+                if (cur_val and passes(prev_val(index, offset), *cur_val))
+                {
+                    kept.push_back(offset);
+                    kept_vals.push_back(*cur_val);
+                }
+            };
+
+            const bool tracked = clean_known and !dirty.empty() and dirty[block_index].page_size != 0;
+            BufferArena::Lease cur_buf = arena->acquire(tracked ? 0 : block_bytes);
+            const bool dense = !tracked and block.encoding != CandidateSet::Encoding::deltas and read_mem_safe(cur_buf.data(), base_address + block.start, block_bytes);
+            if (tracked)
+            {
+                std::vector<std::uintptr_t> dirty_offsets, clean_offsets;
+                split_by_dirty<T>(dirty[block_index], offsets, dirty_offsets, clean_offsets);
+                std::vector<std::optional<T>> dirty_vals(dirty_offsets.size());
+                read_sparse<T>(std::span<const std::uintptr_t>{ dirty_offsets }, [&](std::size_t index, std::uintptr_t, std::optional<T> cur_val)
+                {
+                    dirty_vals[index] = cur_val;
+                });
+
+                std::size_t next_dirty = 0;
+                for (std::size_t i = 0; i < offsets.size(); ++i)
+                {
+                    if (next_dirty < dirty_offsets.size() and dirty_offsets[next_dirty] == offsets[i])
+                        check(i, offsets[i], dirty_vals[next_dirty++]);
+                    else
+                        check(i, offsets[i], prev_val(i, offsets[i]));
+                }
+            }
+            else if (dense)
+            {
+                for (std::size_t i = 0; i < offsets.size(); ++i)
+                {
+                    T cur_val;
+                    std::memcpy(&cur_val, cur_buf.data() + (offsets[i] - block.start), sizeof(T));
+                    check(i, offsets[i], cur_val);
+                }
+            }
+            else
+            {
+                read_sparse<T>(std::span<const std::uintptr_t>{ offsets }, check);
+            }
+
+            control->publish(kept);
+            control->finish_work(block_bytes);
+            if (kept.empty())
+                return;
+
+            results[block_index].append_block(block.start, block.slots, kept);
+            if (dense and kept.size() * 8 >= block.slots)
+                snapshots[block_index] = SnapshotBlock::of_block({ cur_buf.data(), block_bytes });
+            else
+                snapshots[block_index] = SnapshotBlock::of_values(std::as_bytes(std::span<const T>{ kept_vals }));
+        });
+        timer.stop();
+
+        control->throw_if_cancelled();
+        cur_where_offsets = merge_candidate_sets(stride, results);
+        snapshot.emplace();
+        for (auto& block_snapshot : snapshots)
+        {
+            if (block_snapshot)
+                snapshot->emplace_back(std::move(*block_snapshot));
+        }
+    }
+
+public:
+
+    explicit Scanner(std::unique_ptr<MemorySource> memory, unsigned num_threads = std::thread::hardware_concurrency())
+        :   memory(std::move(memory)), pool(std::make_unique<ThreadPool>(num_threads))
+    {
+        regions.refresh(*this->memory);
+        base_address = this->memory->get_base_address();
+
+        // Reading ahead only pays where it has a core of its own, or when reads block (e.g. on swapped out pages).
+        set_read_ahead(pool->size() < std::thread::hardware_concurrency());
+    }
+
+    explicit Scanner(Process process, unsigned num_threads = std::thread::hardware_concurrency())
+        :   Scanner(std::make_unique<ProcessSource>(std::move(process)), num_threads)
+    {}
+
     Scanner(const Scanner& copy) = delete;
     Scanner& operator=(const Scanner& copy) = delete;
 
-    Scanner(Scanner&& move)
+    Scanner(Scanner&& move) = default;
+    Scanner& operator=(Scanner&& move) = default;
+
+    std::string_view get_process_name() const
     {
-        process = move.process;
-        move.process = nullptr;
-        bit64 = move.bit64;
-        ro_pages = std::move(move.ro_pages);
-        cur_where_offsets = std::move(move.cur_where_offsets);
-        cur_where_val = std::move(move.cur_where_val);
+        return memory->get_name();
     }
 
-    Scanner& operator=(Scanner&& move)
+    unsigned long get_process_id() const
     {
-        process = move.process;
-        move.process = nullptr;
-        bit64 = move.bit64;
-        ro_pages = std::move(move.ro_pages);
-        cur_where_offsets = std::move(move.cur_where_offsets);
-        cur_where_val = std::move(move.cur_where_val);
-        return *this;
+        return memory->get_id();
     }
 
-    ~Scanner()
+    unsigned get_thread_count() const
     {
-        if (process)
+        return pool->size();
+    }
+
+    // Turns reading the next windows while comparing the current one on or off, see for_each_window.
+    // Returns whether it is on: sources held in memory or without async reads always scan synchronously.
+    bool set_read_ahead(bool on)
+    {
+        readers.clear();
+        if (!on or memory->has_views())
+            return false;
+
+        for (unsigned i = 0; i < pool->size(); ++i)
         {
-            CloseHandle(process);
+            std::unique_ptr<AsyncReader> reader = memory->open_async_reader();
+            if (!reader)
+            {
+                readers.clear();
+                return false;
+            }
+            readers.push_back(std::move(reader));
         }
+        return true;
     }
 
-    std::string_view get_process_name() const
+    bool get_read_ahead() const
     {
-        return process_name;
+        return !readers.empty();
     }
 
-    unsigned long get_process_id() const
+    // Counters and phase timers of the scans run since the last ScanStats::begin_command.
+    ScanStats& get_stats() const
+    {
+        return *stats;
+    }
+
+    // Progress and cancellation of the scans run since the last ScanControl::begin_command. Safe to use from other
+    // threads while a scan runs.
+    ScanControl& get_control() const
+    {
+        return *control;
+    }
+
+    // Sets the size of the windows regions are streamed through during scans, clamped to [1, 16] MiB in whole pages.
+    void set_window_size(std::size_t bytes)
     {
-        return process_id;
+        bytes = std::clamp(bytes, min_window_size, max_window_size);
+        window_size = bytes / BufferArena::alignment * BufferArena::alignment;
+        arena->trim();
+    }
+
+    std::size_t get_window_size() const
+    {
+        return window_size;
     }
 
     template <typename T>
     std::optional<T> read_mem(std::uintptr_t offset) const
     {
         T val;
-        if (read_mem_safe(&val, reinterpret_cast<LPCVOID>(base_address + offset), sizeof val))
+        if (read_mem_safe(&val, base_address + offset, sizeof val))
         {
             return val;
         };
@@ -213,6 +1054,14 @@ public:
         return {};
     }
 
+    // Reads the value at each of the sorted offsets, nearby ones together in one batched read (see read_sparse), and
+    // calls on_read(index, offset, std::optional<T>) in order.
+    template <typename T, typename F>
+    void read_values(std::span<const std::uintptr_t> offsets, F&& on_read) const
+    {
+        read_sparse<T>(offsets, std::forward<F>(on_read));
+    }
+
     std::string read_string(std::uintptr_t offset, std::size_t max_size=256) const
     {
         std::array<char, 64> buf;
@@ -222,7 +1071,7 @@ public:
         std::size_t total_read = 0;
         while (total_read < max_size)
         {
-            if (!read_mem_safe(buf.data(), reinterpret_cast<LPCVOID>(next_read), sizeof buf))
+            if (!read_mem_safe(buf.data(), next_read, sizeof buf))
             {
                 return str;
             }
@@ -250,7 +1099,7 @@ public:
     std::unique_ptr<T[]> read_array(std::uintptr_t offset, std::size_t size) const
     {
         std::unique_ptr<T[]> val = std::make_unique_for_overwrite<T[]>(size);
-        if (read_mem_safe(val.get(), reinterpret_cast<LPCVOID>(base_address + offset), size * sizeof(T)))
+        if (read_mem_safe(val.get(), base_address + offset, size * sizeof(T)))
         {
             return val;
         }
@@ -260,32 +1109,21 @@ public:
         }
     }
 
-    std::vector<AddressRange> scan_pages(DWORD protect) const
+    // Regions of the given protection, as of the last refresh of the region map.
+    std::vector<AddressRange> scan_pages(PageProtection protection) const
     {
         std::vector<AddressRange> pages;
-
-        MEMORY_BASIC_INFORMATION mbi;
-        LPVOID address = nullptr;
-
-        while (VirtualQueryEx(process, address, &mbi, sizeof mbi) == sizeof mbi)
+        for (const MemoryRegion& region : regions.get_regions())
         {
-            AddressRange page_range { reinterpret_cast<std::uintptr_t>(mbi.BaseAddress), mbi.RegionSize };
-
-            if (mbi.State == MEM_COMMIT and mbi.Protect == protect)
-            {
-                pages.emplace_back(page_range);
-            }
-
-            auto next_addr = reinterpret_cast<std::uintptr_t>(mbi.BaseAddress) + mbi.RegionSize;
-            address = (LPVOID) next_addr;
+            if (!region.executable and region.writable == (protection == PageProtection::read_write))
+                pages.push_back(region.range);
         }
-
         return pages;
     }
 
     bool is_64_bit() const
     {
-        return bit64;
+        return memory->is_64_bit();
     }
 
     int bytes_in_pointer() const
@@ -293,95 +1131,360 @@ public:
         return is_64_bit() ? 8 : 4;
     }
 
+    // Starts a chain with every value equal to val. A cancelled scan leaves the previous chain in place, as do all the
+    // chain's steps.
     template <typename T>
-    std::span<const std::uintptr_t> where_val(T val)
+    const CandidateSet& where_val(T val)
     {
-        cur_where_offsets.clear();
+        prepare_full_scan();
+        reset_dirty_tracking();
+        CandidateSet found = where_val_internal(val);
+
+        typed_where.clear();
+        snapshot.reset();
         cur_where_val = val;
+        cur_where_offsets = std::move(found);
+        return cur_where_offsets;
+    }
 
-        cur_where_offsets = where_val_internal(val);
+    // Starts a chain with the values passing 'pred'. An equality starts a chain with a known value like where_val;
+    // any other predicate starts one with a snapshot of the values found, like where_unknown.
+    template <typename T>
+    const CandidateSet& where_matching(const ValuePredicate<T>& pred)
+    {
+        if (pred.kind == PredicateKind::equal)
+            return where_val(pred.a);
 
+        prepare_full_scan();
+        reset_dirty_tracking();
+        with_kernel(pred, [&](const auto& kernel){ where_matching_internal<T>(kernel); });
+        typed_where.clear();
         return cur_where_offsets;
     }
 
-    std::vector<std::uintptr_t> where_val(std::string_view str)
+    CandidateSet where_val(std::string_view str, StringSearchOptions options = {})
     {
-        std::vector<std::uintptr_t> offsets;
+        const StringSearcher searcher { str, options };
+        prepare_full_scan();
 
-        for (const auto page : get_all_pages())
+        return scan_windows(1, searcher.length() - 1, [&searcher](std::uintptr_t window_offset, std::span<const std::byte> data, std::size_t window_bytes, std::vector<std::uintptr_t>& out)
         {
-            // read entire range so that iterating over chars doesn't redundantly read.
-            std::unique_ptr<char[]> buf = read_array<char>(page.start() - base_address, page.size());
+            auto buf = reinterpret_cast<const unsigned char*>(data.data());
+            searcher.find_all(buf, data.size(), window_bytes, [&](std::size_t offset)
+            {
+                out.push_back(window_offset + offset);
+            });
+        });
+    }
 
-            if (!buf)
-                continue;
+    // Finds every match of each signature in one pass over memory, code included, so byte patterns of instructions
+    // can be located. Returns one candidate set per signature.
+    std::vector<CandidateSet> where_signatures(std::span<const Signature> signatures)
+    {
+        prepare_full_scan();
 
-            for (std::size_t offset = 0; offset + str.length() <= page.size(); ++offset)
+        // Each window is handed to every signature in cache sized chunks, so it is only read from memory once.
+        constexpr std::size_t chunk_size = 64 * 1024;
+        std::size_t overlap = 0;
+        for (const Signature& signature : signatures)
+        {
+            overlap = std::max(overlap, signature.length() - 1);
+        }
+        const std::vector<std::uint32_t> strides(signatures.size(), 1);
+
+        return scan_windows(regions.get_readable_pages(), strides, overlap, [&](std::uintptr_t window_offset, std::span<const std::byte> data, std::size_t window_bytes, std::span<std::vector<std::uintptr_t>> outs)
+        {
+            auto buf = reinterpret_cast<const unsigned char*>(data.data());
+            for (std::size_t chunk = 0; chunk < window_bytes; chunk += chunk_size)
             {
-                std::string_view view { buf.get() + offset, str.length() };
-                if (view == str)
+                const std::size_t limit = std::min(chunk_size, window_bytes - chunk);
+                for (std::size_t i = 0; i < signatures.size(); ++i)
                 {
-                    offsets.push_back(page.get_address_offset(offset) - base_address);
+                    signatures[i].find_all(buf + chunk, data.size() - chunk, limit, [&](std::size_t offset)
+                    {
+                        outs[i].push_back(window_offset + chunk + offset);
+                    });
                 }
             }
+        });
+    }
+
+    // Starts a chain for a value whose type is unknown in a single pass: 'vals' holds the value as each type it may be
+    // stored as, and every window of memory is read once and compared against all of them. With unaligned, each type is
+    // matched at every byte rather than only at multiples of its size. Each type keeps its own candidates, which later
+    // steps of the chain filter as that type.
+    const std::vector<TypedCandidates>& where_vals(std::span<const Value> vals, bool unaligned = false)
+    {
+        prepare_full_scan();
+        reset_dirty_tracking();
+
+        std::vector<std::uint32_t> strides;
+        std::size_t overlap = 0;
+        for (const Value& val : vals)
+        {
+            const std::size_t size = val.visit([](auto v){ return sizeof v; });
+            strides.push_back(unaligned ? 1 : static_cast<std::uint32_t>(size));
+            overlap = std::max(overlap, unaligned ? size - 1 : 0);
         }
 
-        return offsets;
+        std::vector<CandidateSet> found = scan_windows(strides, overlap, [&](std::uintptr_t window_offset, std::span<const std::byte> data, std::size_t window_bytes, std::span<std::vector<std::uintptr_t>> outs)
+        {
+            for (std::size_t i = 0; i < vals.size(); ++i)
+            {
+                vals[i].visit([&](auto v)
+                {
+                    using T = decltype(v);
+                    if (unaligned)
+                        CompareKernels::find_equal_unaligned<T>(data, window_bytes, v, window_offset, outs[i]);
+                    else
+                        CompareKernels::find_equal<T>({ reinterpret_cast<const T*>(data.data()), window_bytes / sizeof(T) }, v, window_offset, outs[i]);
+                });
+            }
+        });
+
+        cur_where_offsets.clear();
+        typed_where.clear();
+        snapshot.reset();
+        for (std::size_t i = 0; i < vals.size(); ++i)
+        {
+            typed_where.push_back({ vals[i], std::move(found[i]) });
+        }
+        return typed_where;
     }
 
-    template <typename T>
-    bool eq_vals(T val1, T val2) const
+    // Keeps the candidates of a where_vals chain whose value is now the value of their type in 'vals'.
+    const std::vector<TypedCandidates>& where_vals_became(std::span<const Value> vals)
+    {
+        filter_typed_chain(vals, true);
+        return typed_where;
+    }
+
+    // Keeps the candidates of a where_vals chain whose value differs from their type's value at the previous step.
+    const std::vector<TypedCandidates>& where_vals_changed()
     {
-        if constexpr(std::is_floating_point_v<T>)
+        std::vector<Value> prev_vals;
+        for (const TypedCandidates& typed : typed_where)
         {
-            constexpr T precision = 0.001;
-            auto dif = std::abs(val1 - val2);
-            return dif <= precision;
+            prev_vals.push_back(typed.val);
         }
-        else
+        filter_typed_chain(prev_vals, false);
+        return typed_where;
+    }
+
+    // Finds every struct matching all fields of the pattern in one pass, returning the offsets of the structs' starts.
+    // Only the anchor field (see StructPattern::anchor_field) is scanned for, with its vectorized kernel; the other
+    // fields of each match are verified from the same window buffer, which overlaps the next window by the struct's
+    // span so no struct is missed at a boundary. Structs are matched wherever the anchor field is aligned to its size.
+    CandidateSet where_struct(const StructPattern& pattern)
+    {
+        const std::size_t anchor = pattern.anchor_field();
+        const std::size_t pointer_size = bytes_in_pointer();
+        const std::size_t span = pattern.span(pointer_size);
+        const std::size_t anchor_offset = pattern.fields[anchor].offset;
+
+        // The remaining fields, tested through a type erased check: they only run on the anchor's matches.
+        struct FieldCheck
+        {
+            std::size_t offset;
+            std::function<bool(const std::byte*)> passes;
+        };
+        std::vector<FieldCheck> checks;
+        for (std::size_t i = 0; i < pattern.fields.size(); ++i)
         {
-            return val1 == val2;
+            if (i == anchor)
+                continue;
+
+            std::visit([&]<typename P>(const P& pred)
+            {
+                if constexpr(std::is_same_v<P, StructPattern::Pointer>)
+                {
+                    checks.push_back({ pattern.fields[i].offset, [this, pointer_size](const std::byte* field)
+                    {
+                        std::uint64_t pointer = 0;
+                        std::memcpy(&pointer, field, pointer_size);
+                        return regions.is_readable(static_cast<std::uintptr_t>(pointer));
+                    } });
+                }
+                else
+                {
+                    using T = decltype(pred.a);
+                    with_kernel(pred, [&](const auto& kernel)
+                    {
+                        checks.push_back({ pattern.fields[i].offset, [kernel](const std::byte* field)
+                        {
+                            return kernel(CompareKernels::load(reinterpret_cast<const T*>(field)));
+                        } });
+                    });
+                }
+            }, pattern.fields[i].test);
         }
+
+        prepare_full_scan();
+        return std::visit([&]<typename P>(const P& pred) -> CandidateSet
+        {
+            if constexpr(std::is_same_v<P, StructPattern::Pointer>)
+            {
+                return CandidateSet{ 1 }; // never the anchor.
+            }
+            else
+            {
+                using T = decltype(pred.a);
+                return with_kernel(pred, [&](const auto& kernel)
+                {
+                    return scan_windows(sizeof(T), span - 1, [&](std::uintptr_t window_offset, std::span<const std::byte> data, std::size_t window_bytes, std::vector<std::uintptr_t>& out)
+                    {
+                        if (data.size() < span)
+                            return;
+
+                        // Struct starts every sizeof(T) bytes, as far as the whole struct is in the buffer.
+                        const std::size_t count = std::min(window_bytes / sizeof(T), (data.size() - span) / sizeof(T) + 1);
+                        std::span<const T> anchors { reinterpret_cast<const T*>(data.data() + anchor_offset), count };
+                        std::vector<std::uintptr_t> starts;
+                        CompareKernels::find_matching(anchors, kernel, 0, starts);
+
+                        for (std::uintptr_t start : starts)
+                        {
+                            const bool all_pass = std::all_of(checks.begin(), checks.end(), [&](const FieldCheck& check)
+                            {
+                                return check.passes(data.data() + start + check.offset);
+                            });
+                            if (all_pass)
+                                out.push_back(window_offset + start);
+                        }
+                    });
+                });
+            }
+        }, pattern.fields[anchor].test);
     }
 
     template <typename T>
-    std::span<const std::uintptr_t> where_became(T val) // prev == cur_where_val and cur == val
+    bool eq_vals(T val1, T val2) const
     {
-        std::vector<std::uintptr_t> offsets;
-        offsets.reserve(cur_where_offsets.size());
+        return CompareKernels::values_equal(val1, val2);
+    }
+
+    // Starts a chain without a known value: every aligned slot of every region is a candidate and the memory is
+    // snapshotted (compressed) so later filters can compare against it.
+    template <typename T>
+    const CandidateSet& where_unknown()
+    {
+        prepare_full_scan();
+        reset_dirty_tracking();
+        const std::vector<ScanWindow> windows = plan_scan(get_all_pages());
+        std::vector<CandidateSet> results(windows.size(), CandidateSet{ sizeof(T) });
+        std::vector<std::optional<SnapshotBlock>> snapshots(windows.size());
 
-        for (std::uintptr_t offset : cur_where_offsets)
+        for_each_window(windows, 0, [&](std::size_t window_index, std::span<const std::byte> data)
         {
-            auto cur_val = read_mem<T>(offset);
-            if (cur_val and eq_vals(*cur_val, val))
-            {
-                offsets.push_back(offset);
-            }
+            const ScanWindow& window = windows[window_index];
+            const auto slots = static_cast<std::uint32_t>(window.range.size() / sizeof(T));
+            results[window_index].append_whole_block(window.range.start() - base_address, slots);
+            snapshots[window_index] = SnapshotBlock::of_block(data.first(slots * sizeof(T)));
+        });
+
+        typed_where.clear();
+        cur_where_offsets = merge_candidate_sets(sizeof(T), results);
+        cur_where_val = T{}; // only records the chain's type.
+        snapshot.emplace();
+        for (auto& window_snapshot : snapshots)
+        {
+            if (window_snapshot)
+                snapshot->emplace_back(std::move(*window_snapshot));
         }
 
-        cur_where_offsets = std::move(offsets);
+        return cur_where_offsets;
+    }
+
+    template <typename T>
+    const CandidateSet& where_became(T val) // prev == cur_where_val and cur == val
+    {
+        const std::vector<DirtyPages> dirty = begin_tracked_step();
+        // Unknown chains have no single previous value, and floats were only matched within a tolerance.
+        std::optional<T> clean_val;
+        if (!snapshot and std::is_integral_v<T>)
+            clean_val = cur_where_val.get<T>();
+
+        cur_where_offsets = filter_candidates<T>(cur_where_offsets, CompareKernels::Equal<T>{ val }, dirty, clean_val);
         cur_where_val = val;
+        snapshot.reset(); // every survivor now has the known value.
+        return cur_where_offsets;
+    }
+
+    // Keeps the candidates whose value now passes 'pred'. An equality is where_became; with any other predicate the
+    // survivors' values differ, so their current values become the chain's snapshot.
+    template <typename T>
+    const CandidateSet& where_became_matching(const ValuePredicate<T>& pred)
+    {
+        if (pred.kind == PredicateKind::equal)
+            return where_became(pred.a);
+
+        with_kernel(pred, [&](const auto& kernel)
+        {
+            filter_changes<T>([&kernel](T, T cur){ return kernel(cur); });
+        });
         return cur_where_offsets;
     }
 
     template<typename T>
-    std::span<const std::uintptr_t> where_changed() // prev != cur
+    const CandidateSet& where_changed() // prev != cur
     {
-        std::vector<std::uintptr_t> offsets;
-        offsets.reserve(cur_where_offsets.size());
+        if (snapshot)
+        {
+            return where_change_filter<T>(ChangeFilter::changed);
+        }
 
+        const std::vector<DirtyPages> dirty = begin_tracked_step();
         auto prev_val = cur_where_val.get<T>();
-        for (std::uintptr_t offset : cur_where_offsets)
+        std::optional<T> clean_val;
+        if (std::is_integral_v<T>)
+            clean_val = prev_val;
+
+        cur_where_offsets = filter_candidates<T>(cur_where_offsets, CompareKernels::Not<CompareKernels::Equal<T>>{ { prev_val } }, dirty, clean_val);
+        return cur_where_offsets;
+    }
+
+    // Keeps the candidates whose value changed in the given way since the previous step of the chain.
+    // The chain keeps a snapshot from here on, since survivors no longer share one known value.
+    template <typename T>
+    const CandidateSet& where_change_filter(ChangeFilter filter, T by = T{})
+    {
+        with_change_test<T>(filter, by, [&](auto passes){ filter_changes<T>(passes); });
+        return cur_where_offsets;
+    }
+
+    // Opt in soft dirty tracking: chain steps only re-read candidates on pages written since the previous step, the
+    // others keep their previous value. Returns false (and stays off) where the platform or kernel cannot track.
+    bool set_dirty_tracking(bool enabled)
+    {
+        if (enabled and !memory->supports_dirty_tracking())
+            enabled = false;
+
+        track_dirty = enabled;
+        dirty_baseline.reset();
+        return track_dirty;
+    }
+
+    bool is_dirty_tracking() const
+    {
+        return track_dirty;
+    }
+
+    bool has_snapshot() const
+    {
+        return snapshot.has_value();
+    }
+
+    std::size_t snapshot_memory_usage() const
+    {
+        std::size_t total = 0;
+        if (snapshot)
         {
-            auto cur_val = read_mem<T>(offset);
-            if (cur_val and !eq_vals(prev_val, *cur_val))
+            for (const SnapshotBlock& block : *snapshot)
             {
-                offsets.push_back(offset);
+                total += block.memory_usage();
             }
         }
-
-        cur_where_offsets = std::move(offsets);
-        return cur_where_offsets;
+        return total;
     }
 
     bool is_sizeof_pointer(auto val) const
@@ -389,9 +1492,32 @@ public:
         return bytes_in_pointer() == sizeof val;
     }
 
-    bool is_possible_pointer(auto val) const
+    // Reads 'size' bytes at every value that points into a readable region, all in one batched read.
+    // Values are classified in process first, so the ones that are not pointers cost nothing.
+    // Returns the bytes read per value, nullopt where the value is not a readable pointer.
+    std::vector<std::optional<std::string>> deref_pointers(std::span<const std::uintptr_t> pointers, std::size_t size) const
     {
-        return std::is_integral_v<decltype(val)> and is_sizeof_pointer(val);
+        std::vector<char> bytes(pointers.size() * size);
+        std::vector<ReadRequest> requests;
+        std::vector<std::size_t> request_of(pointers.size(), SIZE_MAX);
+        for (std::size_t i = 0; i < pointers.size(); ++i)
+        {
+            if (regions.is_readable(pointers[i], size))
+            {
+                request_of[i] = requests.size();
+                requests.push_back({ pointers[i], bytes.data() + i * size, size });
+            }
+        }
+
+        read_batch(requests);
+
+        std::vector<std::optional<std::string>> results(pointers.size());
+        for (std::size_t i = 0; i < pointers.size(); ++i)
+        {
+            if (request_of[i] != SIZE_MAX and requests[request_of[i]].ok)
+                results[i].emplace(bytes.data() + i * size, size);
+        }
+        return results;
     }
 
     template <typename T>
@@ -400,36 +1526,235 @@ public:
         return cur_where_val.get<T>();
     }
 
-    void scan_pointers_to_internal(std::unordered_map<std::uintptr_t, std::vector<std::uintptr_t>>& pointed_to_map, std::uintptr_t offset) const
+    // Builds the reverse pointer index in one parallel pass: every aligned, pointer sized value in scanned memory that
+    // falls inside a scanned region is recorded as (target, source).
+    template <typename P>
+    PointerIndex build_pointer_index_internal() const
+    {
+        const std::vector<AddressRange> mapped = get_all_pages();
+        if (mapped.empty())
+            return {};
+
+        const std::uintptr_t lowest = mapped.front().start();
+        const std::uintptr_t highest = mapped.back().end();
+        auto is_mapped = [&](std::uintptr_t address)
+        {
+            if (address < lowest or address >= highest)
+                return false;
+            const MemoryRegion* region = regions.find(address);
+            return region and !region->executable;
+        };
+
+        const std::vector<ScanWindow> windows = plan_scan(mapped);
+        std::vector<std::vector<PointerIndex::Edge>> results(windows.size());
+
+        for_each_window(windows, 0, [&](std::size_t window_index, std::span<const std::byte> data)
+        {
+            const ScanWindow& window = windows[window_index];
+            const auto* values = reinterpret_cast<const P*>(data.data());
+            for (std::size_t i = 0; i < window.range.size() / sizeof(P); ++i)
+            {
+                if (is_mapped(values[i]))
+                {
+                    results[window_index].push_back({ values[i], window.range.get_address_offset(i * sizeof(P)) });
+                }
+            }
+        });
+
+        std::size_t total = 0;
+        for (const auto& result : results)
+        {
+            total += result.size();
+        }
+
+        std::vector<PointerIndex::Edge> edges;
+        edges.reserve(total);
+        for (auto& result : results)
+        {
+            edges.insert(edges.end(), result.begin(), result.end());
+            result = {};
+        }
+
+        stats->add(ScanCounter::matches, edges.size());
+        return PointerIndex{ std::move(edges) };
+    }
+
+    // Rebuilds the reverse pointer index from the current memory. Pointer queries use the index built last.
+    const PointerIndex& build_pointer_index()
     {
-        const auto& pointers = pointed_to_map[offset] = is_64_bit() ? where_val_internal(base_address + offset) : where_val_internal(static_cast<uint32_t>(base_address + offset));
+        prepare_full_scan();
+        pointer_index = is_64_bit() ? build_pointer_index_internal<std::uint64_t>() : build_pointer_index_internal<std::uint32_t>();
+        return *pointer_index;
+    }
 
-        for (auto pointer : pointers)
+    // Offsets holding a pointer to the given offset.
+    std::vector<std::uintptr_t> pointers_to(std::uintptr_t offset)
+    {
+        if (!pointer_index)
+            build_pointer_index();
+
+        std::vector<std::uintptr_t> offsets;
+        for (std::uintptr_t source : pointer_index->pointers_to(base_address + offset))
         {
-            scan_pointers_to_internal(pointed_to_map, pointer);
+            offsets.push_back(source - base_address);
         }
+        return offsets;
     }
 
-    std::unordered_map<std::uintptr_t, std::vector<std::uintptr_t>> scan_pointers_to(std::uintptr_t offset) const
+    // Graph of pointers to the offset, pointers to those pointers and so on, up to max_depth levels.
+    PointerGraph scan_pointers_to(std::uintptr_t offset, int max_depth)
     {
-        std::unordered_map<std::uintptr_t, std::vector<std::uintptr_t>> pointed_to_map;
+        return PointerGraph{ offset, max_depth, [this](std::uintptr_t node)
+        {
+            control->throw_if_cancelled();
+            return pointers_to(node);
+        } };
+    }
 
-        scan_pointers_to_internal(pointed_to_map, offset);
+    // Searches backwards from the given offset for pointer paths starting in the executable's image (see PointerPathOptions),
+    // one parallel breadth first level at a time over the pointer index. Every address is expanded only the first time
+    // it is reached, which bounds the search by the number of indexed pointers.
+    // Calls on_path(static_offset, offsets) for every path found, shortest paths first. A cancelled search throws
+    // ScanCancelled at the next level, after the paths of the levels done.
+    template <typename F>
+    void find_pointer_paths(std::uintptr_t offset, const PointerPathOptions& options, F&& on_path)
+    {
+        if (!pointer_index)
+            build_pointer_index();
 
-        return pointed_to_map;
+        struct Step
+        {
+            std::uintptr_t address;
+            std::uint32_t parent; // index into the previous level.
+            std::uintptr_t field_offset; // added to the pointer stored at 'address' to reach the parent.
+        };
+
+        constexpr std::size_t steps_per_task = 256;
+        const PointerIndex& index = *pointer_index;
+        const AddressRange module = memory->get_module_range();
+
+        std::vector<std::vector<Step>> levels;
+        levels.push_back({ { base_address + offset, 0, 0 } });
+        std::unordered_set<std::uintptr_t> expanded { base_address + offset };
+        std::vector<std::uintptr_t> path_offsets;
+
+        for (int depth = 1; depth <= options.max_depth and !levels.back().empty(); ++depth)
+        {
+            control->throw_if_cancelled();
+            const std::vector<Step>& frontier = levels.back();
+            const std::size_t num_tasks = (frontier.size() + steps_per_task - 1) / steps_per_task;
+            std::vector<std::vector<Step>> found(num_tasks);
+            std::vector<std::vector<Step>> found_static(num_tasks);
+
+            pool->parallel_for(num_tasks, [&](std::size_t task)
+            {
+                const std::size_t end = std::min(frontier.size(), (task + 1) * steps_per_task);
+                for (std::size_t i = task * steps_per_task; i < end; ++i)
+                {
+                    const std::uintptr_t address = frontier[i].address;
+                    auto [first, last] = index.targets_in(address - std::min(address, options.max_offset), address);
+                    for (std::size_t t = first; t < last; ++t)
+                    {
+                        const std::uintptr_t field_offset = address - index.target_at(t);
+                        for (std::uintptr_t source : index.sources_of(t))
+                        {
+                            Step step { source, static_cast<std::uint32_t>(i), field_offset };
+                            (module.contains(source) ? found_static : found)[task].push_back(step);
+                        }
+                    }
+                }
+            });
+
+            for (const auto& steps : found_static)
+            {
+                for (const Step& step : steps)
+                {
+                    path_offsets.clear();
+                    path_offsets.push_back(step.field_offset);
+                    std::uint32_t parent = step.parent;
+                    for (int level = depth - 1; level > 0; --level)
+                    {
+                        path_offsets.push_back(levels[level][parent].field_offset);
+                        parent = levels[level][parent].parent;
+                    }
+                    on_path(step.address - base_address, std::span<const std::uintptr_t>{ path_offsets });
+                }
+            }
+
+            std::vector<Step> next;
+            for (const auto& steps : found)
+            {
+                for (const Step& step : steps)
+                {
+                    if (expanded.insert(step.address).second)
+                        next.push_back(step);
+                }
+            }
+            levels.push_back(std::move(next));
+        }
+    }
+
+    // Writes every scanned region (see get_all_pages) to a snapshot file, window by window, optionally compressed.
+    // Unreadable windows are left out, splitting their region. Returns the number of memory bytes stored.
+    std::size_t write_snapshot(const std::string& path, bool compress)
+    {
+        prepare_full_scan();
+        SnapshotFileWriter writer { path, *memory, compress, window_size };
+
+        std::size_t total = 0;
+        for (const MemoryRegion& region : regions.get_regions())
+        {
+            if (region.executable)
+                continue;
+
+            bool in_region = false;
+            for (const ScanWindow& window : split_into_windows(std::span<const AddressRange>{ &region.range, 1 }))
+            {
+                BufferArena::Lease buf = lease_window(window.range.size());
+                std::span<const std::byte> data = load_window(buf, window.range.start(), window.range.size());
+                if (data.empty())
+                {
+                    writer.end_region();
+                    in_region = false;
+                    continue;
+                }
+
+                if (!in_region)
+                {
+                    writer.begin_region({ window.range, region.writable, region.executable, region.anonymous });
+                    in_region = true;
+                }
+                writer.append(data);
+                total += data.size();
+            }
+            writer.end_region();
+        }
+
+        writer.finish();
+        return total;
+    }
+
+    // Re-reads the region table if the target's memory map changed since the last refresh.
+    const RegionMap& refresh_regions()
+    {
+        regions.refresh(*memory);
+        return regions;
+    }
+
+    const RegionMap& get_regions() const
+    {
+        return regions;
     }
 
+    // Regions scanned by where and pointers, as of the last refresh.
     std::vector<AddressRange> get_all_pages() const
     {
-        std::vector<AddressRange> all = ro_pages;
-        std::vector<AddressRange> rw = get_rw_pages();
-        all.insert(all.end(), rw.begin(), rw.end());
-        return all;
+        return regions.get_data_pages();
     }
 
     std::vector<AddressRange> get_rw_pages() const
     {
-        return scan_pages(PAGE_READWRITE);
+        return scan_pages(PageProtection::read_write);
     }
 
     std::uintptr_t get_relative_address(std::uintptr_t address) const
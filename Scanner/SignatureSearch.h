@@ -0,0 +1,254 @@
+#ifndef SCANNER_SIGNATURESEARCH_H
+#define SCANNER_SIGNATURESEARCH_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "CompareKernels.h"
+
+// An array of bytes signature with wildcards, e.g. "48 8B 05 ?? ?? ?? ?? 48 85 C0". A byte is two hex digits, either
+// of which can be a ? wildcard ("4?" matches 0x40 to 0x4F); "?" alone is a whole wildcard byte. Bytes may also be
+// written without spaces ("488B05????").
+// Matches are found with a vectorized filter on the two rarest fully known bytes of the signature, which rules out
+// almost every position with two compares, and candidates are verified against the masked pattern.
+class Signature
+{
+    std::vector<unsigned char> bytes; // known bits of each byte, zero where wildcarded.
+    std::vector<unsigned char> mask; // which bits of each byte are known.
+    std::size_t anchor_a = 0;
+    std::size_t anchor_b = 0;
+
+    // How common each byte value is in typical x86-64 code and data, higher is more common. A rough ranking is enough
+    // to keep zeros, 0xFF, REX prefixes and the most used opcodes out of the filter.
+    static constexpr std::array<unsigned char, 256> byte_commonness = []
+    {
+        std::array<unsigned char, 256> commonness {};
+        commonness.fill(10);
+        for (int c = 'a'; c <= 'z'; ++c)
+            commonness[c] = 20;
+        const std::pair<unsigned char, unsigned char> common[]
+        {
+            {0x00, 255}, {0xFF, 200}, {0x48, 160}, {0x8B, 140}, {0x89, 120}, {0x0F, 100}, {0xE8, 90}, {0x24, 90},
+            {0x4C, 80}, {0x44, 80}, {0x83, 80}, {0x01, 70}, {0xC0, 70}, {0x8D, 60}, {0x85, 60}, {0x74, 60},
+            {0x45, 60}, {0xCC, 60}, {0x90, 60}, {0x20, 60}, {0x41, 50}, {0x49, 50}, {0xC3, 50}, {0x02, 50},
+            {0x04, 50}, {0x08, 50}, {0x10, 50}, {0x40, 50}, {0x75, 40}, {0xE9, 40}, {0xEB, 40}, {0x80, 40},
+        };
+        for (auto [byte, rank] : common)
+            commonness[byte] = rank;
+        return commonness;
+    }();
+
+    static int hex_digit(char c)
+    {
+        if (c >= '0' and c <= '9')
+            return c - '0';
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (c >= 'a' and c <= 'f')
+            return c - 'a' + 10;
+        return -1;
+    }
+
+    void add_byte(std::string_view digits)
+    {
+        unsigned char byte = 0;
+        unsigned char byte_mask = 0;
+        for (char c : digits)
+        {
+            byte <<= 4;
+            byte_mask <<= 4;
+            if (c == '?')
+                continue;
+
+            const int digit = hex_digit(c);
+            if (digit < 0)
+                throw std::runtime_error("Invalid signature byte " + std::string{ digits } + ".");
+            byte |= static_cast<unsigned char>(digit);
+            byte_mask |= 0xF;
+        }
+        bytes.push_back(byte);
+        mask.push_back(byte_mask);
+    }
+
+    bool matches_at(const unsigned char* candidate) const
+    {
+        for (std::size_t i = 0; i < bytes.size(); ++i)
+        {
+            if ((candidate[i] & mask[i]) != bytes[i])
+                return false;
+        }
+        return true;
+    }
+
+    template <typename F>
+    void find_scalar(const unsigned char* data, std::size_t size, std::size_t first, std::size_t limit, F& on_match) const
+    {
+        for (std::size_t pos = first; pos < limit and pos + bytes.size() <= size; ++pos)
+        {
+            if (data[pos + anchor_a] == bytes[anchor_a] and matches_at(data + pos))
+                on_match(pos);
+        }
+    }
+
+    // Calls on_match for every verified candidate whose lane is set in the anchor mask of block 'pos'.
+    template <typename F>
+    void verify_mask(std::uint64_t lanes, const unsigned char* data, std::size_t size, std::size_t pos, std::size_t limit, F& on_match) const
+    {
+        while (lanes)
+        {
+            const std::size_t candidate = pos + static_cast<std::size_t>(std::countr_zero(lanes));
+            if (candidate >= limit or candidate + bytes.size() > size)
+                return;
+            if (matches_at(data + candidate))
+                on_match(candidate);
+            lanes &= lanes - 1;
+        }
+    }
+
+    std::size_t far_anchor() const
+    {
+        return std::max(anchor_a, anchor_b);
+    }
+
+#ifdef SCANNER_X86
+
+    template <typename F>
+    SCANNER_TARGET_SSE2 void find_sse2(const unsigned char* data, std::size_t size, std::size_t limit, F& on_match) const
+    {
+        const __m128i a = _mm_set1_epi8(static_cast<char>(bytes[anchor_a]));
+        const __m128i b = _mm_set1_epi8(static_cast<char>(bytes[anchor_b]));
+
+        std::size_t pos = 0;
+        for (; pos < limit and pos + far_anchor() + 16 <= size; pos += 16)
+        {
+            __m128i at_a = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + anchor_a)), a);
+            __m128i at_b = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + anchor_b)), b);
+            verify_mask(static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_and_si128(at_a, at_b))), data, size, pos, limit, on_match);
+        }
+        find_scalar(data, size, pos, limit, on_match);
+    }
+
+    template <typename F>
+    SCANNER_TARGET_AVX2 void find_avx2(const unsigned char* data, std::size_t size, std::size_t limit, F& on_match) const
+    {
+        const __m256i a = _mm256_set1_epi8(static_cast<char>(bytes[anchor_a]));
+        const __m256i b = _mm256_set1_epi8(static_cast<char>(bytes[anchor_b]));
+
+        std::size_t pos = 0;
+        for (; pos < limit and pos + far_anchor() + 32 <= size; pos += 32)
+        {
+            __m256i at_a = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + anchor_a)), a);
+            __m256i at_b = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + anchor_b)), b);
+            verify_mask(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(at_a, at_b))), data, size, pos, limit, on_match);
+        }
+        find_scalar(data, size, pos, limit, on_match);
+    }
+
+    template <typename F>
+    SCANNER_TARGET_AVX512 void find_avx512(const unsigned char* data, std::size_t size, std::size_t limit, F& on_match) const
+    {
+        const __m512i a = _mm512_set1_epi8(static_cast<char>(bytes[anchor_a]));
+        const __m512i b = _mm512_set1_epi8(static_cast<char>(bytes[anchor_b]));
+
+        std::size_t pos = 0;
+        for (; pos < limit and pos + far_anchor() + 64 <= size; pos += 64)
+        {
+            __mmask64 at_a = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(data + pos + anchor_a), a);
+            __mmask64 at_b = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(data + pos + anchor_b), b);
+            verify_mask(at_a & at_b, data, size, pos, limit, on_match);
+        }
+        find_scalar(data, size, pos, limit, on_match);
+    }
+
+#endif
+
+public:
+
+    explicit Signature(std::string_view text)
+    {
+        std::size_t pos = 0;
+        while (pos < text.size())
+        {
+            if (std::isspace(static_cast<unsigned char>(text[pos])))
+            {
+                ++pos;
+                continue;
+            }
+
+            std::size_t end = pos;
+            while (end < text.size() and !std::isspace(static_cast<unsigned char>(text[end])))
+                ++end;
+            const std::string_view token = text.substr(pos, end - pos);
+            pos = end;
+
+            if (token == "?")
+            {
+                add_byte("??");
+                continue;
+            }
+            if (token.size() % 2 != 0)
+                throw std::runtime_error("Invalid signature byte " + std::string{ token } + ".");
+            for (std::size_t i = 0; i < token.size(); i += 2)
+            {
+                add_byte(token.substr(i, 2));
+            }
+        }
+
+        // The two rarest fully known bytes, at different positions where there are two.
+        const std::size_t none = bytes.size();
+        anchor_a = anchor_b = none;
+        for (std::size_t i = 0; i < bytes.size(); ++i)
+        {
+            if (mask[i] != 0xFF)
+                continue;
+            if (anchor_a == none or byte_commonness[bytes[i]] < byte_commonness[bytes[anchor_a]])
+            {
+                anchor_b = anchor_a;
+                anchor_a = i;
+            }
+            else if (anchor_b == none or byte_commonness[bytes[i]] < byte_commonness[bytes[anchor_b]])
+            {
+                anchor_b = i;
+            }
+        }
+
+        if (anchor_a == none)
+            throw std::runtime_error("A signature needs at least one fully known byte.");
+        if (anchor_b == none)
+            anchor_b = anchor_a;
+    }
+
+    // Number of bytes a match spans.
+    std::size_t length() const
+    {
+        return bytes.size();
+    }
+
+    // Calls on_match(position) in increasing order for every match in data[0, size) that starts before 'limit'.
+    template <typename F>
+    void find_all(const unsigned char* data, std::size_t size, std::size_t limit, F&& on_match) const
+    {
+        if (bytes.size() > size)
+            return;
+
+#ifdef SCANNER_X86
+        switch (CompareKernels::active_isa())
+        {
+            case CompareKernels::Isa::avx512: return find_avx512(data, size, limit, on_match);
+            case CompareKernels::Isa::avx2: return find_avx2(data, size, limit, on_match);
+            case CompareKernels::Isa::sse2: return find_sse2(data, size, limit, on_match);
+            default: break;
+        }
+#endif
+        find_scalar(data, size, 0, limit, on_match);
+    }
+};
+
+#endif //SCANNER_SIGNATURESEARCH_H
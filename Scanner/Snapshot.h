@@ -0,0 +1,69 @@
+#ifndef SCANNER_SNAPSHOT_H
+#define SCANNER_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "Compression.h"
+
+// Compressed previous values of one candidate block of an unknown value chain.
+// Dense blocks keep a copy of the block's whole memory, sparse blocks only the values of their candidates (in order).
+class SnapshotBlock
+{
+public:
+
+    enum class Layout : std::uint8_t
+    {
+        block_bytes,
+        candidate_values,
+    };
+
+private:
+
+    Layout layout;
+    std::size_t raw_size;
+    std::vector<std::uint8_t> data;
+
+    SnapshotBlock(Layout layout, std::span<const std::byte> bytes)
+        :   layout(layout), raw_size(bytes.size())
+    {
+        Compression::compress(bytes, data);
+        data.shrink_to_fit();
+    }
+
+public:
+
+    static SnapshotBlock of_block(std::span<const std::byte> block_bytes)
+    {
+        return { Layout::block_bytes, block_bytes };
+    }
+
+    static SnapshotBlock of_values(std::span<const std::byte> candidate_values)
+    {
+        return { Layout::candidate_values, candidate_values };
+    }
+
+    Layout get_layout() const
+    {
+        return layout;
+    }
+
+    // Uncompressed size in bytes.
+    std::size_t size() const
+    {
+        return raw_size;
+    }
+
+    void restore(std::span<std::byte> out) const
+    {
+        Compression::decompress(data, out.first(raw_size));
+    }
+
+    std::size_t memory_usage() const
+    {
+        return data.capacity();
+    }
+};
+
+#endif //SCANNER_SNAPSHOT_H
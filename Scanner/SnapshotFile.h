@@ -0,0 +1,269 @@
+#ifndef SCANNER_SNAPSHOTFILE_H
+#define SCANNER_SNAPSHOTFILE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Compression.h"
+#include "MappedFile.h"
+#include "MemorySource.h"
+
+// Container file holding a copy of a process's memory, written by the snapshot command.
+// Layout: one page of header, then the data of every region starting on a page boundary (so mapped raw regions are
+// page aligned like the original memory), then the region table. Raw regions are stored as is; compressed regions
+// as a sequence of chunks of 'chunk_size' bytes (the last may be shorter), each a u64 compressed size followed by the
+// Compression codec's output. Integers are in the host's byte order.
+namespace SnapshotFormat
+{
+
+    constexpr char magic[8] = { 'M', 'A', 'S', 'N', 'A', 'P', '\r', '\n' };
+    constexpr std::uint32_t version = 1;
+    constexpr std::size_t alignment = 4096;
+
+    enum HeaderFlags : std::uint32_t
+    {
+        bit64 = 1,
+    };
+
+    enum RegionFlags : std::uint32_t
+    {
+        writable = 1,
+        executable = 2,
+        anonymous = 4,
+    };
+
+    enum class Encoding : std::uint32_t
+    {
+        raw,
+        compressed,
+    };
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t flags;
+        std::uint64_t process_id;
+        std::uint64_t base_address;
+        std::uint64_t module_start;
+        std::uint64_t module_size;
+        std::uint64_t chunk_size;
+        std::uint64_t region_count;
+        std::uint64_t region_table_offset;
+        char name[256];
+    };
+
+    struct RegionEntry
+    {
+        std::uint64_t start;
+        std::uint64_t size;
+        std::uint64_t data_offset;
+        std::uint64_t data_size;
+        std::uint32_t flags;
+        Encoding encoding;
+    };
+
+    static_assert(sizeof(Header) <= alignment);
+    static_assert(sizeof(RegionEntry) == 40);
+
+}
+
+// Streams regions into a snapshot file. Regions are written one at a time: begin_region, any number of contiguous
+// append calls, end_region. finish writes the region table and header.
+class SnapshotFileWriter
+{
+    std::ofstream file;
+    SnapshotFormat::Header header {};
+    std::vector<SnapshotFormat::RegionEntry> entries;
+    bool in_region = false;
+    std::vector<std::uint8_t> compressed;
+
+    void pad_to_alignment()
+    {
+        const auto pos = static_cast<std::uint64_t>(file.tellp());
+        const std::uint64_t padding = (SnapshotFormat::alignment - pos % SnapshotFormat::alignment) % SnapshotFormat::alignment;
+        static constexpr char zeros[SnapshotFormat::alignment] {};
+        file.write(zeros, static_cast<std::streamsize>(padding));
+    }
+
+public:
+
+    SnapshotFileWriter(const std::string& path, const MemorySource& source, bool compress, std::size_t chunk_size)
+        :   file(path, std::ios::binary | std::ios::trunc)
+    {
+        if (!file)
+        {
+            throw std::runtime_error("Could not open file " + path + ".");
+        }
+
+        std::memcpy(header.magic, SnapshotFormat::magic, sizeof header.magic);
+        header.version = SnapshotFormat::version;
+        header.flags = source.is_64_bit() ? static_cast<std::uint32_t>(SnapshotFormat::bit64) : 0u;
+        header.process_id = source.get_id();
+        header.base_address = source.get_base_address();
+        header.module_start = source.get_module_range().start();
+        header.module_size = source.get_module_range().size();
+        header.chunk_size = compress ? chunk_size : 0;
+        std::string_view name = source.get_name();
+        std::memcpy(header.name, name.data(), std::min(name.size(), sizeof header.name - 1));
+
+        // Placeholder, rewritten by finish.
+        file.write(reinterpret_cast<const char*>(&header), sizeof header);
+    }
+
+    SnapshotFileWriter(const SnapshotFileWriter& copy) = delete;
+    SnapshotFileWriter& operator=(const SnapshotFileWriter& copy) = delete;
+
+    void begin_region(const MemoryRegion& region)
+    {
+        end_region();
+        pad_to_alignment();
+
+        std::uint32_t flags = 0;
+        flags |= region.writable ? static_cast<std::uint32_t>(SnapshotFormat::writable) : 0u;
+        flags |= region.executable ? static_cast<std::uint32_t>(SnapshotFormat::executable) : 0u;
+        flags |= region.anonymous ? static_cast<std::uint32_t>(SnapshotFormat::anonymous) : 0u;
+        const auto encoding = header.chunk_size ? SnapshotFormat::Encoding::compressed : SnapshotFormat::Encoding::raw;
+        entries.push_back({ region.range.start(), 0, static_cast<std::uint64_t>(file.tellp()), 0, flags, encoding });
+        in_region = true;
+    }
+
+    // Appends the next bytes of the current region. With compression, every call but the region's last must pass
+    // exactly chunk_size bytes.
+    void append(std::span<const std::byte> bytes)
+    {
+        SnapshotFormat::RegionEntry& entry = entries.back();
+        if (entry.encoding == SnapshotFormat::Encoding::raw)
+        {
+            file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            entry.data_size += bytes.size();
+        }
+        else
+        {
+            compressed.clear();
+            Compression::compress(bytes, compressed);
+            const std::uint64_t compressed_size = compressed.size();
+            file.write(reinterpret_cast<const char*>(&compressed_size), sizeof compressed_size);
+            file.write(reinterpret_cast<const char*>(compressed.data()), static_cast<std::streamsize>(compressed.size()));
+            entry.data_size += sizeof compressed_size + compressed.size();
+        }
+        entry.size += bytes.size();
+    }
+
+    void end_region()
+    {
+        if (in_region and entries.back().size == 0)
+            entries.pop_back();
+        in_region = false;
+    }
+
+    void finish()
+    {
+        end_region();
+        pad_to_alignment();
+
+        header.region_count = entries.size();
+        header.region_table_offset = static_cast<std::uint64_t>(file.tellp());
+        file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(SnapshotFormat::RegionEntry)));
+        file.seekp(0);
+        file.write(reinterpret_cast<const char*>(&header), sizeof header);
+        file.flush();
+
+        if (!file)
+        {
+            throw std::runtime_error("Could not write snapshot file.");
+        }
+    }
+};
+
+// A snapshot file opened as a read only memory source. The file is mapped and raw regions are scanned in place;
+// compressed regions are decompressed once when the file is opened.
+class SnapshotFileSource final : public LocalMemorySource
+{
+    MappedFile file;
+    SnapshotFormat::Header header;
+    std::string name;
+    std::vector<std::unique_ptr<std::byte[]>> decompressed;
+
+    [[noreturn]] static void corrupt()
+    {
+        throw std::runtime_error("Corrupt snapshot file.");
+    }
+
+    const std::byte* decompress_region(const SnapshotFormat::RegionEntry& entry, std::span<const std::byte> data)
+    {
+        auto& region = decompressed.emplace_back(std::make_unique_for_overwrite<std::byte[]>(entry.size));
+        std::size_t pos = 0;
+        for (std::uint64_t done = 0; done < entry.size; done += header.chunk_size)
+        {
+            std::uint64_t compressed_size;
+            if (pos + sizeof compressed_size > data.size())
+                corrupt();
+            std::memcpy(&compressed_size, data.data() + pos, sizeof compressed_size);
+            pos += sizeof compressed_size;
+            if (compressed_size > data.size() - pos)
+                corrupt();
+
+            const auto chunk = std::min<std::uint64_t>(header.chunk_size, entry.size - done);
+            Compression::decompress({ reinterpret_cast<const std::uint8_t*>(data.data() + pos), compressed_size }, { region.get() + done, chunk });
+            pos += compressed_size;
+        }
+        return region.get();
+    }
+
+public:
+
+    explicit SnapshotFileSource(const std::string& path)
+        :   file(path)
+    {
+        std::span<const std::byte> bytes = file.bytes();
+        if (bytes.size() < sizeof header)
+            corrupt();
+        std::memcpy(&header, bytes.data(), sizeof header);
+        if (std::memcmp(header.magic, SnapshotFormat::magic, sizeof header.magic) != 0 or header.version != SnapshotFormat::version)
+            throw std::runtime_error(path + " is not a snapshot file.");
+
+        name.assign(header.name, strnlen(header.name, sizeof header.name));
+
+        const std::uint64_t table_bytes = header.region_count * sizeof(SnapshotFormat::RegionEntry);
+        if (header.region_table_offset > bytes.size() or table_bytes > bytes.size() - header.region_table_offset)
+            corrupt();
+
+        for (std::uint64_t i = 0; i < header.region_count; ++i)
+        {
+            SnapshotFormat::RegionEntry entry;
+            std::memcpy(&entry, bytes.data() + header.region_table_offset + i * sizeof entry, sizeof entry);
+            if (entry.data_offset > bytes.size() or entry.data_size > bytes.size() - entry.data_offset)
+                corrupt();
+
+            std::span<const std::byte> data = bytes.subspan(entry.data_offset, entry.data_size);
+            const std::byte* region_data = nullptr;
+            if (entry.encoding == SnapshotFormat::Encoding::raw and entry.data_size == entry.size)
+                region_data = data.data();
+            else if (entry.encoding == SnapshotFormat::Encoding::compressed and header.chunk_size != 0)
+                region_data = decompress_region(entry, data);
+            else
+                corrupt();
+
+            const MemoryRegion region { { entry.start, entry.size }, (entry.flags & SnapshotFormat::writable) != 0, (entry.flags & SnapshotFormat::executable) != 0, (entry.flags & SnapshotFormat::anonymous) != 0 };
+            local_regions.push_back({ region, region_data });
+        }
+        sort_local_regions();
+    }
+
+    std::string_view get_name() const override { return name; }
+    unsigned long get_id() const override { return static_cast<unsigned long>(header.process_id); }
+    bool is_64_bit() const override { return header.flags & SnapshotFormat::bit64; }
+    std::uintptr_t get_base_address() const override { return header.base_address; }
+    AddressRange get_module_range() const override { return { header.module_start, header.module_size }; }
+};
+
+#endif //SCANNER_SNAPSHOTFILE_H
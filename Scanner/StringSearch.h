@@ -0,0 +1,284 @@
+#ifndef SCANNER_STRINGSEARCH_H
+#define SCANNER_STRINGSEARCH_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include "CompareKernels.h"
+
+struct StringSearchOptions
+{
+    bool utf16 = false; // search for the UTF-16LE encoding of the (UTF-8) needle.
+    bool case_insensitive = false; // ASCII letters only.
+};
+
+// Finds every occurrence of a needle in a byte buffer.
+// Short needles use a vectorized filter on the needle's first and last byte (memchr style) and verify the candidates,
+// long needles use Horspool's bad character skips. Each needle position accepts up to two bytes, which is how the
+// case insensitive mode is handled by both.
+class StringSearcher
+{
+    static constexpr std::size_t long_needle = 32;
+
+    std::vector<unsigned char> pattern;
+    std::vector<unsigned char> alternate; // second accepted byte per position, equal to pattern where only one is.
+    bool exact; // no position has an alternate, so candidates can be verified with memcmp.
+    std::array<std::size_t, 256> shift;
+
+    static std::vector<char16_t> utf8_to_utf16(std::string_view str)
+    {
+        std::vector<char16_t> units;
+        std::size_t i = 0;
+        while (i < str.size())
+        {
+            auto lead = static_cast<unsigned char>(str[i]);
+            int extra = lead < 0x80 ? 0 : lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : -1;
+            if (extra < 0 or i + extra + 1 > str.size())
+            {
+                throw std::runtime_error("Invalid UTF-8 string.");
+            }
+
+            char32_t code_point = extra == 0 ? lead : lead & (0x3F >> extra);
+            for (int k = 1; k <= extra; ++k)
+            {
+                code_point = (code_point << 6) | (static_cast<unsigned char>(str[i + k]) & 0x3F);
+            }
+            i += extra + 1;
+
+            if (code_point >= 0x10000)
+            {
+                code_point -= 0x10000;
+                units.push_back(static_cast<char16_t>(0xD800 + (code_point >> 10)));
+                units.push_back(static_cast<char16_t>(0xDC00 + (code_point & 0x3FF)));
+            }
+            else
+            {
+                units.push_back(static_cast<char16_t>(code_point));
+            }
+        }
+        return units;
+    }
+
+    static unsigned char other_case(unsigned char byte)
+    {
+        if (byte >= 'a' and byte <= 'z')
+            return byte - 'a' + 'A';
+        if (byte >= 'A' and byte <= 'Z')
+            return byte - 'A' + 'a';
+        return byte;
+    }
+
+    bool matches_at(const unsigned char* text, std::size_t position) const
+    {
+        return text[position] == pattern[position] or text[position] == alternate[position];
+    }
+
+    bool verify(const unsigned char* candidate) const
+    {
+        if (exact)
+        {
+            return std::memcmp(candidate, pattern.data(), pattern.size()) == 0;
+        }
+
+        for (std::size_t i = 0; i < pattern.size(); ++i)
+        {
+            if (!matches_at(candidate, i))
+                return false;
+        }
+        return true;
+    }
+
+    template <typename F>
+    void find_horspool(const unsigned char* data, std::size_t size, std::size_t limit, F& on_match) const
+    {
+        const std::size_t last = pattern.size() - 1;
+        std::size_t pos = 0;
+        while (pos < limit and pos + pattern.size() <= size)
+        {
+            const unsigned char end_byte = data[pos + last];
+            if ((end_byte == pattern[last] or end_byte == alternate[last]) and verify(data + pos))
+            {
+                on_match(pos);
+            }
+            pos += shift[end_byte];
+        }
+    }
+
+    template <typename F>
+    void find_scalar(const unsigned char* data, std::size_t size, std::size_t first, std::size_t limit, F& on_match) const
+    {
+        for (std::size_t pos = first; pos < limit and pos + pattern.size() <= size; ++pos)
+        {
+            if (verify(data + pos))
+            {
+                on_match(pos);
+            }
+        }
+    }
+
+    // Calls on_match for every verified candidate whose lane is set in the first/last byte mask of block 'pos'.
+    template <typename F>
+    void verify_mask(std::uint64_t mask, const unsigned char* data, std::size_t pos, std::size_t limit, F& on_match) const
+    {
+        while (mask)
+        {
+            std::size_t candidate = pos + static_cast<std::size_t>(std::countr_zero(mask));
+            if (candidate >= limit)
+                return;
+            if (verify(data + candidate))
+                on_match(candidate);
+            mask &= mask - 1;
+        }
+    }
+
+#ifdef SCANNER_X86
+
+    template <typename F>
+    SCANNER_TARGET_SSE2 void find_sse2(const unsigned char* data, std::size_t size, std::size_t limit, F& on_match) const
+    {
+        const std::size_t last = pattern.size() - 1;
+        const __m128i first_a = _mm_set1_epi8(static_cast<char>(pattern[0]));
+        const __m128i first_b = _mm_set1_epi8(static_cast<char>(alternate[0]));
+        const __m128i last_a = _mm_set1_epi8(static_cast<char>(pattern[last]));
+        const __m128i last_b = _mm_set1_epi8(static_cast<char>(alternate[last]));
+
+        std::size_t pos = 0;
+        for (; pos < limit and pos + last + 16 <= size; pos += 16)
+        {
+            __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+            __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos + last));
+            __m128i head_eq = _mm_or_si128(_mm_cmpeq_epi8(head, first_a), _mm_cmpeq_epi8(head, first_b));
+            __m128i tail_eq = _mm_or_si128(_mm_cmpeq_epi8(tail, last_a), _mm_cmpeq_epi8(tail, last_b));
+            auto mask = static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_and_si128(head_eq, tail_eq)));
+            verify_mask(mask, data, pos, limit, on_match);
+        }
+        find_scalar(data, size, pos, limit, on_match);
+    }
+
+    template <typename F>
+    SCANNER_TARGET_AVX2 void find_avx2(const unsigned char* data, std::size_t size, std::size_t limit, F& on_match) const
+    {
+        const std::size_t last = pattern.size() - 1;
+        const __m256i first_a = _mm256_set1_epi8(static_cast<char>(pattern[0]));
+        const __m256i first_b = _mm256_set1_epi8(static_cast<char>(alternate[0]));
+        const __m256i last_a = _mm256_set1_epi8(static_cast<char>(pattern[last]));
+        const __m256i last_b = _mm256_set1_epi8(static_cast<char>(alternate[last]));
+
+        std::size_t pos = 0;
+        for (; pos < limit and pos + last + 32 <= size; pos += 32)
+        {
+            __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+            __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + last));
+            __m256i head_eq = _mm256_or_si256(_mm256_cmpeq_epi8(head, first_a), _mm256_cmpeq_epi8(head, first_b));
+            __m256i tail_eq = _mm256_or_si256(_mm256_cmpeq_epi8(tail, last_a), _mm256_cmpeq_epi8(tail, last_b));
+            auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(head_eq, tail_eq)));
+            verify_mask(mask, data, pos, limit, on_match);
+        }
+        find_scalar(data, size, pos, limit, on_match);
+    }
+
+    template <typename F>
+    SCANNER_TARGET_AVX512 void find_avx512(const unsigned char* data, std::size_t size, std::size_t limit, F& on_match) const
+    {
+        const std::size_t last = pattern.size() - 1;
+        const __m512i first_a = _mm512_set1_epi8(static_cast<char>(pattern[0]));
+        const __m512i first_b = _mm512_set1_epi8(static_cast<char>(alternate[0]));
+        const __m512i last_a = _mm512_set1_epi8(static_cast<char>(pattern[last]));
+        const __m512i last_b = _mm512_set1_epi8(static_cast<char>(alternate[last]));
+
+        std::size_t pos = 0;
+        for (; pos < limit and pos + last + 64 <= size; pos += 64)
+        {
+            __m512i head = _mm512_loadu_si512(data + pos);
+            __m512i tail = _mm512_loadu_si512(data + pos + last);
+            __mmask64 head_eq = _mm512_cmpeq_epi8_mask(head, first_a) | _mm512_cmpeq_epi8_mask(head, first_b);
+            __mmask64 tail_eq = _mm512_cmpeq_epi8_mask(tail, last_a) | _mm512_cmpeq_epi8_mask(tail, last_b);
+            verify_mask(head_eq & tail_eq, data, pos, limit, on_match);
+        }
+        find_scalar(data, size, pos, limit, on_match);
+    }
+
+#endif
+
+public:
+
+    StringSearcher(std::string_view needle, StringSearchOptions options)
+    {
+        if (options.utf16)
+        {
+            for (char16_t unit : utf8_to_utf16(needle))
+            {
+                pattern.push_back(static_cast<unsigned char>(unit & 0xFF));
+                pattern.push_back(static_cast<unsigned char>(unit >> 8));
+            }
+        }
+        else
+        {
+            pattern.assign(needle.begin(), needle.end());
+        }
+
+        if (pattern.empty())
+        {
+            throw std::runtime_error("Cannot search for an empty string.");
+        }
+
+        alternate = pattern;
+        if (options.case_insensitive)
+        {
+            // In UTF-16 only the low byte of a code unit below 0x100 is a letter.
+            const std::size_t step = options.utf16 ? 2 : 1;
+            for (std::size_t i = 0; i < pattern.size(); i += step)
+            {
+                if (!options.utf16 or pattern[i + 1] == 0)
+                {
+                    alternate[i] = other_case(pattern[i]);
+                }
+            }
+        }
+        exact = pattern == alternate;
+
+        shift.fill(pattern.size());
+        for (std::size_t i = 0; i + 1 < pattern.size(); ++i)
+        {
+            shift[pattern[i]] = pattern.size() - 1 - i;
+            shift[alternate[i]] = pattern.size() - 1 - i;
+        }
+    }
+
+    // Number of bytes a match spans.
+    std::size_t length() const
+    {
+        return pattern.size();
+    }
+
+    // Calls on_match(position) in increasing order for every match in data[0, size) that starts before 'limit'.
+    template <typename F>
+    void find_all(const unsigned char* data, std::size_t size, std::size_t limit, F&& on_match) const
+    {
+        if (pattern.size() > size)
+            return;
+
+        if (pattern.size() > long_needle)
+        {
+            return find_horspool(data, size, limit, on_match);
+        }
+
+#ifdef SCANNER_X86
+        switch (CompareKernels::active_isa())
+        {
+            case CompareKernels::Isa::avx512: return find_avx512(data, size, limit, on_match);
+            case CompareKernels::Isa::avx2: return find_avx2(data, size, limit, on_match);
+            case CompareKernels::Isa::sse2: return find_sse2(data, size, limit, on_match);
+            default: break;
+        }
+#endif
+        find_scalar(data, size, 0, limit, on_match);
+    }
+};
+
+#endif //SCANNER_STRINGSEARCH_H
@@ -0,0 +1,123 @@
+#ifndef SCANNER_STRUCTPATTERN_H
+#define SCANNER_STRUCTPATTERN_H
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <variant>
+#include <vector>
+#include "ValuePredicate.h"
+
+// A struct searched for by several of its fields at once, see Scanner::where_struct.
+struct StructPattern
+{
+    // The field holds a pointer into readable memory (of the target's pointer size).
+    struct Pointer {};
+
+    using Test = std::variant<
+        ValuePredicate<std::int8_t>, ValuePredicate<std::int16_t>, ValuePredicate<std::int32_t>, ValuePredicate<std::int64_t>,
+        ValuePredicate<std::uint8_t>, ValuePredicate<std::uint16_t>, ValuePredicate<std::uint32_t>, ValuePredicate<std::uint64_t>,
+        ValuePredicate<float>, ValuePredicate<double>, Pointer>;
+
+    struct Field
+    {
+        std::size_t offset; // from the start of the struct.
+        Test test;
+    };
+
+    std::vector<Field> fields;
+
+    static std::size_t field_size(const Field& field, std::size_t pointer_size)
+    {
+        return std::visit([pointer_size]<typename P>(const P& pred) -> std::size_t
+        {
+            if constexpr(std::is_same_v<P, Pointer>)
+                return pointer_size;
+            else
+                return sizeof(pred.a);
+        }, field.test);
+    }
+
+    // Bytes from the start of the struct to the end of its last field.
+    std::size_t span(std::size_t pointer_size) const
+    {
+        std::size_t end = 0;
+        for (const Field& field : fields)
+        {
+            end = std::max(end, field.offset + field_size(field, pointer_size));
+        }
+        return end;
+    }
+
+    // Rough fraction of arbitrary memory values that pass a field's test. Zeros and small integers are far more common
+    // than their share of the value range, so equality with them counts as weak; pointers are only checked afterwards.
+    static double estimated_match_rate(const Field& field)
+    {
+        return std::visit([]<typename P>(const P& pred) -> double
+        {
+            if constexpr(std::is_same_v<P, Pointer>)
+            {
+                return 1.0;
+            }
+            else
+            {
+                using T = decltype(pred.a);
+                const double bits = 8.0 * sizeof(T);
+                switch (pred.kind)
+                {
+                    case PredicateKind::equal:
+                    case PredicateKind::ulps:
+                        if (pred.a == T{})
+                            return 0.25;
+                        if constexpr(std::is_integral_v<T>)
+                        {
+                            if (std::abs(static_cast<double>(pred.a)) <= 64.0)
+                                return 0.01;
+                        }
+                        return std::exp2(-std::min(bits, 24.0));
+                    case PredicateKind::mask:
+                        if constexpr(std::is_integral_v<T>)
+                            return std::exp2(-std::popcount(static_cast<std::make_unsigned_t<T>>(pred.a)));
+                        else
+                            return 1.0;
+                    case PredicateKind::between:
+                        if constexpr(std::is_integral_v<T>)
+                            return std::min(1.0, (std::abs(static_cast<double>(pred.b) - static_cast<double>(pred.a)) + 1.0) / std::exp2(std::min(bits, 16.0)));
+                        else
+                            return 0.05;
+                    case PredicateKind::greater:
+                    case PredicateKind::less:
+                        return 0.5;
+                    default:
+                        return 1.0;
+                }
+            }
+        }, field.test);
+    }
+
+    // The field to scan for, the one least likely to match arbitrary memory. The others are verified on its matches.
+    std::size_t anchor_field() const
+    {
+        std::size_t anchor = fields.size();
+        double best_rate = 2.0;
+        for (std::size_t i = 0; i < fields.size(); ++i)
+        {
+            const double rate = estimated_match_rate(fields[i]);
+            if (!std::holds_alternative<Pointer>(fields[i].test) and rate < best_rate)
+            {
+                anchor = i;
+                best_rate = rate;
+            }
+        }
+
+        if (anchor == fields.size())
+            throw std::invalid_argument("A struct pattern needs a field with a value.");
+        return anchor;
+    }
+};
+
+#endif //SCANNER_STRUCTPATTERN_H
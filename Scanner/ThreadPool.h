@@ -0,0 +1,215 @@
+#ifndef SCANNER_THREADPOOL_H
+#define SCANNER_THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool where each worker owns a task deque.
+// Workers take work from the front of their own deque and steal from the back of the others once theirs is empty.
+class ThreadPool
+{
+    using Task = std::function<void()>;
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::atomic<std::size_t> queued = 0; // tasks pushed but not yet taken by a worker.
+    bool stopping = false;
+
+    bool pop_own(std::size_t queue_index, Task& task)
+    {
+        WorkQueue& queue = *queues[queue_index];
+        std::scoped_lock lock { queue.mutex };
+        if (queue.tasks.empty())
+        {
+            return false;
+        }
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    bool steal(std::size_t thief_index, Task& task)
+    {
+        for (std::size_t i = 1; i <= queues.size(); ++i)
+        {
+            WorkQueue& victim = *queues[(thief_index + i) % queues.size()];
+            std::scoped_lock lock { victim.mutex };
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool take_task(std::size_t queue_index, Task& task)
+    {
+        if (pop_own(queue_index, task) or steal(queue_index, task))
+        {
+            --queued;
+            return true;
+        }
+        return false;
+    }
+
+    void worker_loop(std::size_t queue_index)
+    {
+        Task task;
+        while (true)
+        {
+            if (take_task(queue_index, task))
+            {
+                task();
+                continue;
+            }
+
+            std::unique_lock lock { wake_mutex };
+            wake.wait(lock, [this]{ return stopping or queued > 0; });
+            if (stopping and queued == 0)
+            {
+                return;
+            }
+        }
+    }
+
+public:
+
+    explicit ThreadPool(unsigned num_threads)
+    {
+        num_threads = std::max(num_threads, 1u);
+        for (unsigned i = 0; i < num_threads; ++i)
+        {
+            queues.emplace_back(std::make_unique<WorkQueue>());
+        }
+
+        // The thread calling parallel_for also works, so one thread fewer is spawned.
+        for (unsigned i = 1; i < num_threads; ++i)
+        {
+            threads.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+
+    ThreadPool(const ThreadPool& copy) = delete;
+    ThreadPool& operator=(const ThreadPool& copy) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::scoped_lock lock { wake_mutex };
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    unsigned size() const
+    {
+        return static_cast<unsigned>(queues.size());
+    }
+
+    // Calls task(i) for every i in [0, count) and blocks until all calls have returned.
+    // Indices are dealt out in contiguous blocks so each worker starts on neighbouring memory.
+    // The first exception thrown by a task is rethrown here after the remaining tasks finish.
+    template <typename F>
+    void parallel_for(std::size_t count, F&& task)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        if (size() == 1)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                task(i);
+            }
+            return;
+        }
+
+        std::size_t remaining = count;
+        std::mutex done_mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+
+        auto run_one = [&](std::size_t i)
+        {
+            try
+            {
+                task(i);
+            }
+            catch (...)
+            {
+                std::scoped_lock lock { done_mutex };
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            std::scoped_lock lock { done_mutex };
+            if (--remaining == 0)
+            {
+                done.notify_all();
+            }
+        };
+
+        const std::size_t per_queue = (count + size() - 1) / size();
+        for (std::size_t q = 0; q < size(); ++q)
+        {
+            WorkQueue& queue = *queues[q];
+            std::scoped_lock lock { queue.mutex };
+            for (std::size_t i = q * per_queue; i < std::min(count, (q + 1) * per_queue); ++i)
+            {
+                queue.tasks.emplace_back([&run_one, i]{ run_one(i); });
+                ++queued;
+            }
+        }
+        {
+            // Taking the lock orders the pushes before any worker's predicate check, so no wakeup is lost.
+            std::scoped_lock lock { wake_mutex };
+        }
+        wake.notify_all();
+
+        // The caller works on queue 0 until nothing is left to take, then waits for the stragglers.
+        Task own_task;
+        while (take_task(0, own_task))
+        {
+            own_task();
+        }
+
+        std::unique_lock lock { done_mutex };
+        done.wait(lock, [&remaining]{ return remaining == 0; });
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+};
+
+#endif //SCANNER_THREADPOOL_H
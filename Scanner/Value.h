@@ -2,7 +2,9 @@
 #define SCANNER_VALUE_H
 
 #include <variant>
+#include <cstddef>
 #include <cstdint>
+#include <utility>
 
 class Value
 {
@@ -24,6 +26,19 @@ public:
     {
         return std::get<T>(value);
     };
+
+    // Calls f with the held value as its own type.
+    template<typename F>
+    decltype(auto) visit(F&& f) const
+    {
+        return std::visit(std::forward<F>(f), value);
+    }
+
+    // Position of the held value's type in ValueType, equal for values of the same type.
+    std::size_t type_index() const
+    {
+        return value.index();
+    }
 };
 
 #endif //SCANNER_VALUE_H
@@ -0,0 +1,118 @@
+#ifndef SCANNER_VALUEPREDICATE_H
+#define SCANNER_VALUEPREDICATE_H
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include "CompareKernels.h"
+
+enum class PredicateKind
+{
+    equal,
+    not_equal,
+    greater,
+    less,
+    between,
+    mask,
+    ulps,
+};
+
+// A test a where or became step applies to every value, as entered by the user:
+// - equal / not_equal / greater / less: compared to a (floats use CompareKernels::float_tolerance for equality).
+// - between: a <= value <= b, in either order.
+// - mask: the bits set in a equal those bits of b.
+// - ulps: within 'ulps' units in the last place of a for floats, within 'ulps' of a for integers.
+template <typename T>
+struct ValuePredicate
+{
+    PredicateKind kind = PredicateKind::equal;
+    T a {};
+    T b {};
+    std::uint64_t ulps = 0;
+};
+
+// Steps a float by a number of representable values (negative steps go down), saturating at the infinities.
+template <typename T>
+T step_ulps(T val, std::int64_t steps)
+{
+    using Bits = std::conditional_t<sizeof(T) == 4, std::int32_t, std::int64_t>;
+    constexpr std::int64_t min_bits = std::numeric_limits<Bits>::min();
+    if (std::isnan(val))
+        return val;
+
+    // Map the sign and magnitude representation onto integers in the same order as the floats (both zeros to 0).
+    // Distances are taken unsigned: for doubles the ordered range is wider than int64.
+    const std::int64_t bits = std::bit_cast<Bits>(val);
+    const std::int64_t ordered = bits < 0 ? min_bits - bits : bits;
+    const std::int64_t limit = std::bit_cast<Bits>(std::numeric_limits<T>::infinity());
+
+    std::int64_t stepped;
+    if (steps >= 0)
+    {
+        const std::uint64_t room = static_cast<std::uint64_t>(limit) - static_cast<std::uint64_t>(ordered);
+        stepped = static_cast<std::uint64_t>(steps) >= room ? limit : ordered + steps;
+    }
+    else
+    {
+        const std::uint64_t room = static_cast<std::uint64_t>(ordered) + static_cast<std::uint64_t>(limit);
+        stepped = static_cast<std::uint64_t>(-(steps + 1)) + 1 >= room ? -limit : ordered + steps;
+    }
+    return std::bit_cast<T>(static_cast<Bits>(stepped < 0 ? min_bits - stepped : stepped));
+}
+
+// Calls f with the CompareKernels predicate for 'pred', so each kind of predicate and value type runs its own
+// kernel: the predicate kind is switched on once per call here instead of once per value.
+template <typename T, typename F>
+decltype(auto) with_kernel(const ValuePredicate<T>& pred, F&& f)
+{
+    using namespace CompareKernels;
+    constexpr T lowest = std::numeric_limits<T>::lowest();
+    constexpr T highest = std::numeric_limits<T>::max();
+
+    switch (pred.kind)
+    {
+        case PredicateKind::not_equal:
+            return f(Not<Equal<T>>{ { pred.a } });
+        case PredicateKind::greater:
+            if constexpr(std::is_floating_point_v<T>)
+                return f(InRange<T>{ std::nextafter(pred.a, std::numeric_limits<T>::infinity()), std::numeric_limits<T>::infinity() });
+            else
+                return f(Not<InRange<T>>{ { lowest, pred.a } });
+        case PredicateKind::less:
+            if constexpr(std::is_floating_point_v<T>)
+                return f(InRange<T>{ -std::numeric_limits<T>::infinity(), std::nextafter(pred.a, -std::numeric_limits<T>::infinity()) });
+            else
+                return f(Not<InRange<T>>{ { pred.a, highest } });
+        case PredicateKind::between:
+            return f(InRange<T>{ std::min(pred.a, pred.b), std::max(pred.a, pred.b) });
+        case PredicateKind::mask:
+            if constexpr(std::is_integral_v<T>)
+                return f(MaskedEqual<T>{ pred.a, static_cast<T>(pred.a & pred.b) });
+            else
+                break;
+        case PredicateKind::ulps:
+            if constexpr(std::is_floating_point_v<T>)
+            {
+                const auto steps = static_cast<std::int64_t>(std::min<std::uint64_t>(pred.ulps, INT64_MAX));
+                return f(InRange<T>{ step_ulps(pred.a, -steps), step_ulps(pred.a, steps) });
+            }
+            else
+            {
+                // Distances to the type's limits, computed unsigned so they cannot overflow.
+                using U = std::make_unsigned_t<T>;
+                const auto room_below = static_cast<U>(static_cast<U>(pred.a) - static_cast<U>(lowest));
+                const auto room_above = static_cast<U>(static_cast<U>(highest) - static_cast<U>(pred.a));
+                const T below = room_below >= pred.ulps ? static_cast<T>(static_cast<U>(pred.a) - static_cast<U>(pred.ulps)) : lowest;
+                const T above = room_above >= pred.ulps ? static_cast<T>(static_cast<U>(pred.a) + static_cast<U>(pred.ulps)) : highest;
+                return f(InRange<T>{ below, above });
+            }
+        default:
+            break;
+    }
+    return f(Equal<T>{ pred.a });
+}
+
+#endif //SCANNER_VALUEPREDICATE_H
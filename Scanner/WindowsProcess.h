@@ -0,0 +1,266 @@
+#ifndef SCANNER_WINDOWSPROCESS_H
+#define SCANNER_WINDOWSPROCESS_H
+
+#include <windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "AddressRange.h"
+#include "ProcessTypes.h"
+
+class Process
+{
+    std::string process_name;
+    DWORD process_id;
+    HANDLE process = nullptr;
+    bool bit64;
+    std::uintptr_t base_address;
+    std::size_t module_size;
+
+    AddressRange scan_module() const
+    {
+        const DWORD id = GetProcessId(process);
+        MODULEENTRY32 me32;
+        me32.dwSize = sizeof(MODULEENTRY32);
+        HANDLE module_snap = INVALID_HANDLE_VALUE;
+        module_snap = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE, id);
+
+        if(module_snap == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Could not get process module snapshot.");
+        }
+
+        if(!Module32First(module_snap, &me32))
+        {
+            CloseHandle(module_snap);
+            throw std::runtime_error("Could not get first module.");
+        }
+
+        std::uintptr_t base_address = 0;
+        std::size_t module_size = 0;
+        do
+        {
+            if (strcmp(process_name.c_str(), me32.szModule) == 0)
+            {
+                base_address = reinterpret_cast<std::uintptr_t>(me32.modBaseAddr);
+                module_size = me32.modBaseSize;
+            }
+        } while(Module32Next(module_snap, &me32) and base_address == 0);
+
+        CloseHandle(module_snap);
+
+        if (base_address == 0)
+        {
+            throw std::runtime_error("Could not find base address.");
+        }
+
+        return { base_address, module_size };
+    }
+
+public:
+
+    Process(const std::string& window_name)
+    {
+        HWND window = FindWindow(NULL, window_name.c_str());
+
+        if (window)
+        {
+            DWORD process_id;
+            GetWindowThreadProcessId(window, &process_id);
+            this->process_id = process_id;
+
+            process = OpenProcess( PROCESS_VM_READ | PROCESS_QUERY_INFORMATION , FALSE, process_id );
+            if (!process)
+                throw std::runtime_error("Could not open process.");
+
+
+            constexpr int name_max_size = 256;
+            char process_name_buffer[name_max_size];
+            auto name_str_size = GetModuleBaseName(process, NULL, process_name_buffer, name_max_size);
+
+            if (name_str_size == 0)
+                throw std::runtime_error("Could not read process name.");
+
+            process_name = { process_name_buffer, name_str_size };
+
+            BOOL wow64Ret;
+            IsWow64Process(process, &wow64Ret);
+            if (wow64Ret)
+            {
+                bit64 = false; // returns true if process is 32 bit on a 64bit system.
+            }
+            else
+            {
+                // process is same bit as os.
+                SYSTEM_INFO sys_info;
+                GetNativeSystemInfo(&sys_info);
+                bit64 = sys_info.wProcessorArchitecture == PROCESSOR_ARCHITECTURE_AMD64 or
+                        sys_info.wProcessorArchitecture == PROCESSOR_ARCHITECTURE_ARM64 or
+                        sys_info.wProcessorArchitecture == PROCESSOR_ARCHITECTURE_IA64;
+            }
+
+        }
+        else
+        {
+            throw std::runtime_error("Could not find process (Is it running?).");
+        }
+
+        AddressRange module = scan_module();
+        base_address = module.start();
+        module_size = module.size();
+    }
+
+    Process(const Process& copy) = delete;
+    Process& operator=(const Process& copy) = delete;
+
+    Process(Process&& move)
+    {
+        *this = std::move(move);
+    }
+
+    Process& operator=(Process&& move)
+    {
+        std::swap(process, move.process);
+        process_name = std::move(move.process_name);
+        process_id = move.process_id;
+        bit64 = move.bit64;
+        base_address = move.base_address;
+        module_size = move.module_size;
+        return *this;
+    }
+
+    ~Process()
+    {
+        if (process)
+        {
+            CloseHandle(process);
+        }
+    }
+
+    std::string_view get_name() const
+    {
+        return process_name;
+    }
+
+    unsigned long get_id() const
+    {
+        return process_id;
+    }
+
+    bool is_64_bit() const
+    {
+        return bit64;
+    }
+
+    std::uintptr_t get_base_address() const
+    {
+        return base_address;
+    }
+
+    // Memory occupied by the executable's image, starting at the base address.
+    AddressRange get_module_range() const
+    {
+        return { base_address, module_size };
+    }
+
+    [[nodiscard]]
+    bool read(void* buf, std::uintptr_t from, std::size_t to_read) const
+    {
+        SIZE_T bytes_read;
+
+        if (ReadProcessMemory(process, reinterpret_cast<LPCVOID>(from), buf, to_read, &bytes_read) == 0)
+        {
+            // func failed.
+            return false;
+        }
+
+        return to_read == bytes_read;
+    }
+
+    // Windows has no scatter read, so each request still costs one ReadProcessMemory.
+    std::size_t read_batch(std::span<ReadRequest> requests) const
+    {
+        std::size_t num_ok = 0;
+        for (ReadRequest& request : requests)
+        {
+            request.ok = read(request.buffer, request.address, request.size);
+            num_ok += request.ok;
+        }
+        return num_ok;
+    }
+
+    // Replaces 'regions' with the committed, readable regions of the process, unless they hash to 'fingerprint'.
+    // Windows has no cheap change indicator, so the address space is always walked, but callers are spared the update.
+    // Returns whether regions was replaced.
+    bool scan_regions(std::uint64_t& fingerprint, std::vector<MemoryRegion>& regions) const
+    {
+        constexpr DWORD readable = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+        constexpr DWORD writable = PAGE_READWRITE | PAGE_WRITECOPY | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+        constexpr DWORD executable = PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+        std::vector<MemoryRegion> found;
+        std::uint64_t hash = 14695981039346656037ull; // FNV-1a over (base, size, protection).
+        auto add_to_hash = [&hash](std::uint64_t val)
+        {
+            for (int i = 0; i < 8; ++i, val >>= 8)
+            {
+                hash = (hash ^ (val & 0xFF)) * 1099511628211ull;
+            }
+        };
+
+        MEMORY_BASIC_INFORMATION mbi;
+        LPVOID address = nullptr;
+
+        while (VirtualQueryEx(process, address, &mbi, sizeof mbi) == sizeof mbi)
+        {
+            if (mbi.State == MEM_COMMIT and (mbi.Protect & readable) and !(mbi.Protect & PAGE_GUARD))
+            {
+                found.push_back({ { reinterpret_cast<std::uintptr_t>(mbi.BaseAddress), mbi.RegionSize }, (mbi.Protect & writable) != 0, (mbi.Protect & executable) != 0, false });
+                add_to_hash(reinterpret_cast<std::uintptr_t>(mbi.BaseAddress));
+                add_to_hash(mbi.RegionSize);
+                add_to_hash(mbi.Protect);
+            }
+
+            auto next_addr = reinterpret_cast<std::uintptr_t>(mbi.BaseAddress) + mbi.RegionSize;
+            address = (LPVOID) next_addr;
+        }
+
+        if (hash == fingerprint and !regions.empty())
+        {
+            return false;
+        }
+
+        regions = std::move(found);
+        fingerprint = hash;
+        return true;
+    }
+
+    // Page residency is not queried on Windows: every region is reported as unknown (empty bitmap) and read in full.
+    std::size_t scan_untouched_pages(std::span<const MemoryRegion> regions, std::vector<std::vector<std::uint64_t>>& untouched) const
+    {
+        untouched.assign(regions.size(), {});
+        return 4096;
+    }
+
+    // Soft dirty page tracking is Linux only.
+    static bool dirty_tracking_supported()
+    {
+        return false;
+    }
+
+    bool reset_dirty_pages() const
+    {
+        return false;
+    }
+
+    bool scan_dirty_pages(AddressRange range, DirtyPages& dirty) const
+    {
+        return false;
+    }
+};
+
+#endif //SCANNER_WINDOWSPROCESS_H
@@ -0,0 +1,372 @@
+// Scan throughput benchmark: starts memanalyzer_synthetic_target, runs each kind of scan on it a number of times and
+// writes the timings as JSON, so scanner builds can be compared and regressions caught. Every scan must find exactly
+// the values the target planted; the bench exits with 1 if one does not.
+// Usage: memanalyzer_bench [--gb size] [--repeat n] [--threads n] [--window-mb n] [--read-ahead on|off]
+//                          [--target path] [--out file]
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "Scanner/Scanner.h"
+#include "SyntheticLayout.h"
+
+namespace
+{
+
+    struct BenchOptions
+    {
+        double gb = 1.0;
+        int repeat = 5;
+        unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+        std::optional<std::size_t> window_mb;
+        std::optional<bool> read_ahead;
+        std::string target = MEMANALYZER_SYNTHETIC_TARGET;
+        std::string out;
+    };
+
+    BenchOptions parse_options(int argc, char** argv)
+    {
+        BenchOptions options;
+        for (int i = 1; i + 1 < argc; i += 2)
+        {
+            const std::string_view name = argv[i];
+            const std::string value = argv[i + 1];
+            if (name == "--gb")
+                options.gb = std::stod(value);
+            else if (name == "--repeat")
+                options.repeat = std::max(std::stoi(value), 1);
+            else if (name == "--threads")
+                options.threads = static_cast<unsigned>(std::max(std::stoi(value), 1));
+            else if (name == "--window-mb")
+                options.window_mb = std::stoul(value);
+            else if (name == "--read-ahead")
+                options.read_ahead = value == "on";
+            else if (name == "--target")
+                options.target = value;
+            else if (name == "--out")
+                options.out = value;
+            else
+                throw std::invalid_argument("Unknown option " + std::string{ name } + ".");
+        }
+        return options;
+    }
+
+    // The synthetic target, started with its standard streams connected to pipes. Stopped on destruction.
+    class TargetProcess
+    {
+        pid_t pid = -1;
+        FILE* to_target = nullptr;
+        FILE* from_target = nullptr;
+
+        std::string read_line()
+        {
+            std::string line;
+            int c;
+            while ((c = std::fgetc(from_target)) != EOF and c != '\n')
+                line.push_back(static_cast<char>(c));
+            if (c == EOF and line.empty())
+                throw std::runtime_error("The target exited.");
+            return line;
+        }
+
+    public:
+
+        std::uintptr_t chain_end = 0;
+        std::uintptr_t dense = 0;
+        std::size_t dense_bytes = 0;
+
+        TargetProcess(const std::string& path, double gb)
+        {
+            int in_pipe[2];
+            int out_pipe[2];
+            if (pipe(in_pipe) != 0 or pipe(out_pipe) != 0)
+                throw std::runtime_error("Could not create pipes.");
+
+            pid = fork();
+            if (pid < 0)
+                throw std::runtime_error("Could not start the target.");
+            if (pid == 0)
+            {
+                dup2(in_pipe[0], STDIN_FILENO);
+                dup2(out_pipe[1], STDOUT_FILENO);
+                close(in_pipe[0]);
+                close(in_pipe[1]);
+                close(out_pipe[0]);
+                close(out_pipe[1]);
+                const std::string size = std::to_string(gb);
+                execl(path.c_str(), path.c_str(), "--gb", size.c_str(), static_cast<char*>(nullptr));
+                _exit(127);
+            }
+
+            close(in_pipe[0]);
+            close(out_pipe[1]);
+            to_target = fdopen(in_pipe[1], "w");
+            from_target = fdopen(out_pipe[0], "r");
+
+            for (std::string line = read_line(); line != SyntheticLayout::ready; line = read_line())
+            {
+                const std::string_view key = std::string_view{ line }.substr(0, line.find(' '));
+                if (key == SyntheticLayout::key_chain_end)
+                    chain_end = std::stoull(line.substr(key.size() + 1));
+                else if (key == SyntheticLayout::key_dense)
+                    dense = std::stoull(line.substr(key.size() + 1));
+                else if (key == SyntheticLayout::key_dense_bytes)
+                    dense_bytes = std::stoull(line.substr(key.size() + 1));
+            }
+        }
+
+        TargetProcess(const TargetProcess& copy) = delete;
+        TargetProcess& operator=(const TargetProcess& copy) = delete;
+
+        ~TargetProcess()
+        {
+            std::fputs("quit\n", to_target);
+            std::fclose(to_target);
+            std::fclose(from_target);
+            waitpid(pid, nullptr, 0);
+        }
+
+        pid_t get_id() const
+        {
+            return pid;
+        }
+
+        // Adds SyntheticLayout::bump_step to every value of a survivor set.
+        void bump(std::size_t set)
+        {
+            std::fprintf(to_target, "bump %zu\n", set);
+            std::fflush(to_target);
+            if (read_line() != "done")
+                throw std::runtime_error("The target did not bump its values.");
+        }
+    };
+
+    // Matches at cell starts of the target's dense block, where a scan must find exactly what the target planted
+    // (see SyntheticLayout).
+    class PlantedCells
+    {
+        std::uintptr_t start; // offset of the dense block.
+        std::size_t size;
+
+    public:
+
+        PlantedCells(const Scanner& scanner, const TargetProcess& target)
+            :   start(scanner.get_relative_address(target.dense)), size(target.dense_bytes)
+        {}
+
+        bool contains(std::uintptr_t offset) const
+        {
+            return offset - start < size and (offset - start) % SyntheticLayout::cell_size == 0;
+        }
+
+        template <typename Offsets>
+        std::size_t count(const Offsets& offsets) const
+        {
+            return std::count_if(offsets.begin(), offsets.end(), [this](std::uintptr_t offset){ return contains(offset); });
+        }
+    };
+
+    // What a run found: all matches, and those on planted cells.
+    struct Matches
+    {
+        std::size_t all;
+        std::size_t planted;
+    };
+
+    struct BenchResult
+    {
+        std::string name;
+        std::size_t bytes; // bytes scanned per run, 0 where throughput means nothing (filtering candidates).
+        std::size_t matches;
+        std::size_t planted; // matches on planted cells of the first run that missed 'expected', else of the last run.
+        std::size_t expected;
+        std::vector<double> seconds;
+
+        bool correct() const
+        {
+            return planted == expected;
+        }
+    };
+
+    // Runs setup (untimed) then run (timed) 'repeat' times. Every run must find 'expected' matches on planted cells.
+    BenchResult measure(std::string name, std::size_t bytes, std::size_t expected, int repeat, const std::function<void()>& setup, const std::function<Matches()>& run)
+    {
+        BenchResult result { std::move(name), bytes, 0, expected, expected, {} };
+        for (int i = 0; i < repeat; ++i)
+        {
+            setup();
+            const auto start = std::chrono::steady_clock::now();
+            const Matches matches = run();
+            const auto end = std::chrono::steady_clock::now();
+            result.seconds.push_back(std::chrono::duration<double>(end - start).count());
+
+            result.matches = matches.all;
+            if (result.correct())
+                result.planted = matches.planted;
+        }
+
+        std::cerr << result.name << ": " << *std::min_element(result.seconds.begin(), result.seconds.end()) << " s\n";
+        if (!result.correct())
+            std::cerr << result.name << ": found " << result.planted << " planted matches, expected " << result.expected << '\n';
+        return result;
+    }
+
+    BenchResult measure(std::string name, std::size_t bytes, std::size_t expected, int repeat, const std::function<Matches()>& run)
+    {
+        return measure(std::move(name), bytes, expected, repeat, []{}, run);
+    }
+
+    template <typename T>
+    Value as_value(T val)
+    {
+        Value value;
+        value = val;
+        return value;
+    }
+
+    void write_json(std::ostream& out, const BenchOptions& options, const Scanner& scanner, std::size_t scanned_bytes, const std::vector<BenchResult>& results)
+    {
+        out << "{\n";
+        out << "  \"config\": {\n";
+        out << "    \"gb\": " << options.gb << ",\n";
+        out << "    \"repeat\": " << options.repeat << ",\n";
+        out << "    \"threads\": " << scanner.get_thread_count() << ",\n";
+        out << "    \"window_bytes\": " << scanner.get_window_size() << ",\n";
+        out << "    \"read_ahead\": " << (scanner.get_read_ahead() ? "true" : "false") << ",\n";
+        out << "    \"compare_kernels\": \"" << CompareKernels::isa_name(CompareKernels::active_isa()) << "\",\n";
+        out << "    \"scanned_bytes\": " << scanned_bytes << "\n";
+        out << "  },\n";
+        out << "  \"results\": [\n";
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const BenchResult& result = results[i];
+            std::vector<double> sorted = result.seconds;
+            std::sort(sorted.begin(), sorted.end());
+            const double median = sorted[sorted.size() / 2];
+
+            out << "    { \"name\": \"" << result.name << "\", \"matches\": " << result.matches;
+            out << ", \"planted_matches\": " << result.planted << ", \"expected\": " << result.expected;
+            out << ", \"seconds_min\": " << sorted.front() << ", \"seconds_median\": " << median;
+            if (result.bytes > 0)
+                out << ", \"bytes\": " << result.bytes << ", \"gb_per_s\": " << result.bytes / median / 1e9;
+            out << " }" << (i + 1 < results.size() ? "," : "") << '\n';
+        }
+        out << "  ]\n";
+        out << "}\n";
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    using namespace SyntheticLayout;
+
+    const BenchOptions options = parse_options(argc, argv);
+    TargetProcess target { options.target, options.gb };
+
+    Scanner scanner { Process{ target.get_id() }, options.threads };
+    if (options.window_mb)
+        scanner.set_window_size(*options.window_mb * 1024 * 1024);
+    if (options.read_ahead)
+        scanner.set_read_ahead(*options.read_ahead);
+
+    std::size_t scanned_bytes = 0;
+    for (const AddressRange& page : scanner.refresh_regions().get_data_pages())
+    {
+        scanned_bytes += page.size();
+    }
+
+    const int repeat = options.repeat;
+    const PlantedCells cells { scanner, target };
+    std::vector<BenchResult> results;
+    auto matches_of = [&](const CandidateSet& offsets){ return Matches{ offsets.size(), cells.count(offsets) }; };
+
+    auto bench_where = [&]<typename T>(const char* name, T val)
+    {
+        results.push_back(measure(name, scanned_bytes, planted_per_type, repeat, [&]{ return matches_of(scanner.where_val<T>(val)); }));
+    };
+    bench_where("where i8", value_i8);
+    bench_where("where i16", value_i16);
+    bench_where("where i32", value_i32);
+    bench_where("where i64", value_i64);
+    bench_where("where f32", value_f32);
+    bench_where("where f64", value_f64);
+
+    // Only the 32 bit integer types are checked: the fill may come within the float tolerance of value_i32 as a float.
+    const Value all_types[] { as_value(value_i32), as_value(static_cast<std::uint32_t>(value_i32)), as_value(static_cast<std::int64_t>(value_i32)), as_value(static_cast<float>(value_i32)), as_value(static_cast<double>(value_i32)) };
+    results.push_back(measure("where * (5 types)", scanned_bytes, 2 * planted_per_type, repeat, [&]
+    {
+        Matches matches { 0, 0 };
+        for (const TypedCandidates& typed : scanner.where_vals(all_types))
+        {
+            matches.all += typed.offsets.size();
+            if (typed.val.visit([](auto v){ return sizeof v == sizeof(std::int32_t) and std::is_integral_v<decltype(v)>; }))
+                matches.planted += cells.count(typed.offsets);
+        }
+        return matches;
+    }));
+
+    results.push_back(measure("string", scanned_bytes, planted_strings, repeat, [&]{ return matches_of(scanner.where_val(needle)); }));
+    results.push_back(measure("string case insensitive", scanned_bytes, planted_strings, repeat, [&]{ return matches_of(scanner.where_val(needle, { .case_insensitive = true })); }));
+
+    for (std::size_t set = 0; set < survivor_sets; ++set)
+    {
+        // Each run starts a fresh chain on the set's current value, then the target changes every value of the set.
+        std::int32_t current = survivor_values[set];
+        auto start_chain = [&]
+        {
+            scanner.where_val<std::int32_t>(current);
+            target.bump(set);
+            current += bump_step;
+        };
+
+        const std::string survivors = std::to_string(survivor_counts[set]);
+        results.push_back(measure("became " + survivors, 0, survivor_counts[set], repeat, start_chain, [&]{ return matches_of(scanner.where_became<std::int32_t>(current)); }));
+        results.push_back(measure("changed " + survivors, 0, survivor_counts[set], repeat, start_chain, [&]{ return matches_of(scanner.where_changed<std::int32_t>()); }));
+    }
+
+    // Pointers to the last chain node: the planted ones, plus the previous node and the target's own bookkeeping.
+    const std::uintptr_t chain_end = scanner.get_relative_address(target.chain_end);
+    results.push_back(measure("pointer index", scanned_bytes, pointer_fan_in, repeat, [&]
+    {
+        const PointerIndex& index = scanner.build_pointer_index();
+        std::size_t planted = 0;
+        for (std::uintptr_t source : index.pointers_to(target.chain_end))
+            planted += cells.contains(scanner.get_relative_address(source));
+        return Matches{ index.size(), planted };
+    }));
+    results.push_back(measure("pointers", 0, pointer_fan_in, repeat, [&]
+    {
+        const PointerGraph graph = scanner.scan_pointers_to(chain_end, chain_depth);
+        std::size_t planted = 0;
+        for (const PointerGraph::Node& node : graph.children(graph.root()))
+            planted += cells.contains(node.offset);
+        return Matches{ graph.size(), planted };
+    }));
+
+    if (options.out.empty())
+    {
+        write_json(std::cout, options, scanner, scanned_bytes, results);
+    }
+    else
+    {
+        std::ofstream out { options.out };
+        write_json(out, options, scanner, scanned_bytes, results);
+    }
+
+    // A scan that misses or invents matches is a regression, whatever its speed.
+    const bool all_correct = std::all_of(results.begin(), results.end(), [](const BenchResult& result){ return result.correct(); });
+    return all_correct ? 0 : 1;
+}
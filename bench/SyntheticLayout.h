@@ -0,0 +1,59 @@
+#ifndef BENCH_SYNTHETICLAYOUT_H
+#define BENCH_SYNTHETICLAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// What memanalyzer_synthetic_target plants in its memory, shared with memanalyzer_bench so the bench knows what every
+// scan should find.
+//
+// The target allocates the requested number of bytes: 3/4 dense (pseudo random odd 32 bit words) and 1/4 sparse
+// (zeroed, one page touched per MiB). Into the dense part it plants, each at the start of a distinct random cell of
+// cell_size bytes:
+// - planted_per_type copies of each type's value below,
+// - survivor_counts[i] copies of the 32 bit survivor_values[i], the sets whose values the bench bumps to measure
+//   became and changed at different numbers of survivors,
+// - planted_strings copies of the needle,
+// - pointer_fan_in pointers to the last node of a chain of chain_depth heap nodes, whose first node is pointed to by a
+//   global of the target (so paths lead back to its image).
+// Every planted number is even in its low byte, so the odd fill never holds one at a cell start, and the floats are
+// large enough that no other value of their type lies within the scan's tolerance of them: scans find exactly the
+// planted counts at cell starts in the dense block. (Copies elsewhere, e.g. on the target's stack, are not counted.)
+//
+// Protocol: the target prints "key value" lines then "ready" on stdout. On stdin it accepts
+// "bump <set>" (adds bump_step to every value of survivor set <set>, answers "done") and exits on "quit" or end of input.
+namespace SyntheticLayout
+{
+
+    constexpr std::size_t cell_size = 64;
+    constexpr std::size_t planted_per_type = 4096;
+
+    constexpr std::int8_t value_i8 = 0x5A;
+    constexpr std::int16_t value_i16 = 0x5EEC;
+    constexpr std::int32_t value_i32 = 0x5EED1234;
+    constexpr std::int64_t value_i64 = 0x5EED12345678ABCCll;
+    constexpr float value_f32 = 20000.5f;
+    constexpr double value_f64 = 12345678901234.5;
+
+    constexpr std::size_t survivor_sets = 3;
+    constexpr std::size_t survivor_counts[survivor_sets] { 1'000, 100'000, 1'000'000 };
+    constexpr std::int32_t survivor_values[survivor_sets] { 0x10000000, 0x20000000, 0x30000000 };
+    constexpr std::int32_t bump_step = 2; // keeps the values even, see the fill.
+
+    constexpr std::string_view needle = "MemAnalyzerBenchNeedle";
+    constexpr std::size_t planted_strings = 1000;
+
+    constexpr int chain_depth = 4;
+    constexpr std::size_t pointer_fan_in = 1000;
+
+    // Keys of the target's startup lines.
+    constexpr std::string_view key_bytes = "bytes"; // bytes allocated.
+    constexpr std::string_view key_chain_end = "chain_end"; // address of the last chain node, the pointer scan's target.
+    constexpr std::string_view key_dense = "dense"; // address of the dense block.
+    constexpr std::string_view key_dense_bytes = "dense_bytes";
+    constexpr std::string_view ready = "ready";
+
+}
+
+#endif //BENCH_SYNTHETICLAYOUT_H
@@ -0,0 +1,161 @@
+// A process with a known memory layout for memanalyzer_bench to scan, see SyntheticLayout.h.
+// Usage: memanalyzer_synthetic_target [--gb size] (default 1, at least 0.25)
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SyntheticLayout.h"
+
+namespace
+{
+
+    constexpr std::size_t sparse_touch_stride = 1024 * 1024;
+
+    struct ChainNode
+    {
+        ChainNode* next;
+        std::int64_t payload;
+    };
+
+    // First node of the pointer chain, so pointer paths lead back to this image.
+    ChainNode* volatile chain_root = nullptr;
+
+    class CellPicker
+    {
+        std::size_t num_cells;
+        std::size_t step;
+        std::size_t next = 0;
+
+    public:
+
+        // Walks the cells in a scattered order without repeats: a step coprime to the cell count visits every cell.
+        explicit CellPicker(std::size_t num_cells)
+            :   num_cells(num_cells), step(2654435761u % num_cells)
+        {
+            while (std::gcd(step, num_cells) != 1)
+                ++step;
+        }
+
+        std::size_t pick()
+        {
+            return (next++ * step) % num_cells;
+        }
+    };
+
+    double parse_gb(int argc, char** argv)
+    {
+        for (int i = 1; i + 1 < argc; ++i)
+        {
+            if (std::string_view{ argv[i] } == "--gb")
+                return std::stod(argv[i + 1]);
+        }
+        return 1.0;
+    }
+
+}
+
+int main(int argc, char** argv)
+{
+    using namespace SyntheticLayout;
+
+    const double gb = std::max(parse_gb(argc, argv), 0.25);
+    const auto bytes = static_cast<std::size_t>(gb * 1024 * 1024 * 1024);
+    const std::size_t dense_bytes = bytes / 4 * 3 / cell_size * cell_size;
+    const std::size_t sparse_bytes = bytes - dense_bytes;
+
+    // Odd pseudo random words: planted numbers are even, so the fill never matches them at a cell start.
+    auto dense = std::make_unique_for_overwrite<std::uint32_t[]>(dense_bytes / sizeof(std::uint32_t));
+    std::uint32_t state = 0x9E3779B9;
+    for (std::size_t i = 0; i < dense_bytes / sizeof(std::uint32_t); ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        dense[i] = state | 1;
+    }
+
+    // Fresh zero pages: the region stays mostly untouched, unlike a value initialized array.
+    auto* sparse = static_cast<std::byte*>(std::calloc(sparse_bytes, 1));
+    for (std::size_t i = 0; i < sparse_bytes; i += sparse_touch_stride)
+    {
+        sparse[i] = std::byte{ 1 };
+    }
+
+    auto* cells = reinterpret_cast<std::byte*>(dense.get());
+    CellPicker picker { dense_bytes / cell_size };
+    auto plant = [&](const void* value, std::size_t size)
+    {
+        std::byte* cell = cells + picker.pick() * cell_size;
+        std::memcpy(cell, value, size);
+        return cell;
+    };
+
+    auto plant_type = [&](auto value)
+    {
+        for (std::size_t i = 0; i < planted_per_type; ++i)
+            plant(&value, sizeof value);
+    };
+    plant_type(value_i8);
+    plant_type(value_i16);
+    plant_type(value_i32);
+    plant_type(value_i64);
+    plant_type(value_f32);
+    plant_type(value_f64);
+
+    std::vector<std::vector<std::int32_t*>> survivors(survivor_sets);
+    for (std::size_t set = 0; set < survivor_sets; ++set)
+    {
+        for (std::size_t i = 0; i < survivor_counts[set]; ++i)
+            survivors[set].push_back(reinterpret_cast<std::int32_t*>(plant(&survivor_values[set], sizeof(std::int32_t))));
+    }
+
+    for (std::size_t i = 0; i < planted_strings; ++i)
+    {
+        plant(needle.data(), needle.size());
+    }
+
+    std::vector<std::unique_ptr<ChainNode>> chain;
+    for (int i = 0; i < chain_depth; ++i)
+    {
+        chain.push_back(std::make_unique<ChainNode>(ChainNode{ nullptr, i }));
+        if (i > 0)
+            chain[i - 1]->next = chain[i].get();
+    }
+    chain_root = chain.front().get();
+    ChainNode* chain_end = chain.back().get();
+    for (std::size_t i = 0; i < pointer_fan_in; ++i)
+    {
+        plant(&chain_end, sizeof chain_end);
+    }
+
+    std::cout << key_bytes << ' ' << bytes << '\n';
+    std::cout << key_chain_end << ' ' << reinterpret_cast<std::uintptr_t>(chain_end) << '\n';
+    std::cout << key_dense << ' ' << reinterpret_cast<std::uintptr_t>(dense.get()) << '\n';
+    std::cout << key_dense_bytes << ' ' << dense_bytes << '\n';
+    std::cout << ready << std::endl;
+
+    std::string command;
+    while (std::cin >> command and command != "quit")
+    {
+        if (command == "bump")
+        {
+            std::size_t set = 0;
+            std::cin >> set;
+            if (set < survivor_sets)
+            {
+                for (std::int32_t* value : survivors[set])
+                    *value += bump_step;
+            }
+            std::cout << "done" << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -1,15 +1,26 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <fstream>
 #include <iostream>
 #include <functional>
+#include <mutex>
 #include <span>
+#include <thread>
 #include "Scanner/Scanner.h"
 #include "CommandLineUtility.h"
+#include "OutputBuffer.h"
 #include <optional>
 
 using namespace CommandLineUtility;
 
 using ArgList = std::span<std::string_view>;
 using Command = std::function<void(Scanner&, ArgList)>;
-bool running = true;
+std::atomic<bool> running = true;
 
 std::string cur_where_type = "i";
 
@@ -50,6 +61,113 @@ ValueType convert_type(std::string_view type)
     return convert_value("0", type);
 }
 
+bool is_float_type(std::string_view type)
+{
+    return type == "f" or type == "d";
+}
+
+// Predicate keywords accepted by where and became in place of a plain value, with the number of values each takes.
+struct PredicateSyntax
+{
+    std::string_view name;
+    PredicateKind kind;
+    std::size_t num_values;
+};
+
+constexpr PredicateSyntax predicate_syntax[]
+{
+    {"!=", PredicateKind::not_equal, 1},
+    {">", PredicateKind::greater, 1},
+    {"<", PredicateKind::less, 1},
+    {"between", PredicateKind::between, 2},
+    {"mask", PredicateKind::mask, 2},
+    {"ulps", PredicateKind::ulps, 2},
+};
+
+const PredicateSyntax* find_predicate_syntax(std::string_view name)
+{
+    auto it = std::find_if(std::begin(predicate_syntax), std::end(predicate_syntax), [name](const PredicateSyntax& syntax){ return syntax.name == name; });
+    return it != std::end(predicate_syntax) ? it : nullptr;
+}
+
+// Builds the predicate from its values, converted to the chain's type. The step count of ulps is always an integer.
+template <typename T>
+ValuePredicate<T> make_predicate(const PredicateSyntax& syntax, ArgList values, std::string_view type)
+{
+    ValuePredicate<T> pred;
+    pred.kind = syntax.kind;
+    pred.a = std::get<T>(convert_value(values[0], type));
+    if (syntax.kind == PredicateKind::ulps)
+        pred.ulps = lexical_cast<std::uint64_t>(values[1]);
+    else if (syntax.num_values > 1)
+        pred.b = std::get<T>(convert_value(values[1], type));
+    return pred;
+}
+
+// Type given to where to search for a value as every type at once.
+constexpr std::string_view all_types = "*";
+
+template <typename T>
+std::optional<T> parse_number(std::string_view str)
+{
+    T val;
+    std::from_chars_result result;
+    if constexpr(std::is_integral_v<T>)
+    {
+        const bool is_hex = str.length() > 2 and str[0] == '0' and std::tolower(str[1]) == 'x';
+        result = is_hex ? std::from_chars(str.data() + 2, str.data() + str.size(), val, 16) : std::from_chars(str.data(), str.data() + str.size(), val);
+    }
+    else
+    {
+        result = std::from_chars(str.data(), str.data() + str.size(), val);
+    }
+
+    if (result.ec != std::errc{} or result.ptr != str.data() + str.size())
+    {
+        return {};
+    }
+    return val;
+}
+
+// The value as every type it can be stored as: each integer size once (signed, or unsigned if only that can hold it)
+// and both floating point types. With both_signs, integer sizes get the unsigned value too where it also parses, so a
+// chain step keeps the type its candidates were found as. Types the value does not fit are left out.
+std::vector<Value> convert_all_types(std::string_view val_str, bool both_signs = false)
+{
+    std::vector<Value> vals;
+    auto add = [&](auto val){ if (val) vals.emplace_back() = *val; };
+    auto add_integer = [&]<typename T>(T)
+    {
+        auto val = parse_number<T>(val_str);
+        add(val);
+        if (!val or both_signs)
+            add(parse_number<std::make_unsigned_t<T>>(val_str));
+    };
+
+    add_integer(int8_t{});
+    add_integer(int16_t{});
+    add_integer(int32_t{});
+    add_integer(int64_t{});
+    add(parse_number<float>(val_str));
+    add(parse_number<double>(val_str));
+    return vals;
+}
+
+template <typename T>
+std::string_view type_name()
+{
+    if constexpr(std::is_same_v<T, int8_t>) return "c";
+    else if constexpr(std::is_same_v<T, uint8_t>) return "uc";
+    else if constexpr(std::is_same_v<T, int16_t>) return "s";
+    else if constexpr(std::is_same_v<T, uint16_t>) return "us";
+    else if constexpr(std::is_same_v<T, int32_t>) return "i";
+    else if constexpr(std::is_same_v<T, uint32_t>) return "ui";
+    else if constexpr(std::is_same_v<T, int64_t>) return "l";
+    else if constexpr(std::is_same_v<T, uint64_t>) return "ul";
+    else if constexpr(std::is_same_v<T, float>) return "f";
+    else return "d";
+}
+
 template <typename T>
 void print_val(T val)
 {
@@ -76,14 +194,247 @@ void print_val(const std::optional<T>& val)
     }
 }
 
-void print_addresses(std::span<const std::uintptr_t> addresses)
+// One set of addresses of a listing and the type they are listed as.
+struct ListedSet
+{
+    Value tag; // only tags the type.
+    const CandidateSet* offsets; // in the scanner's where chain, or in the listing's found sets.
+};
+
+// The addresses of the last command that listed addresses, kept so 'more' can page through them and 'dump' can write
+// them all. Sets of the where chain are viewed in place rather than copied: the chain only changes through commands
+// that replace the listing (or clear it, see where ?).
+struct Listing
+{
+    std::vector<CandidateSet> found; // sets that are not part of the chain (strings, signatures, structs).
+    std::vector<ListedSet> sets; // listed one after the other.
+    std::vector<std::string> headers; // printed before each set if not empty, e.g. "Signature 2".
+    bool with_types = false; // print each address's type.
+    bool with_values = false; // print each address's current value.
+    std::optional<Value> prev_val; // the value every address held at the previous step, printed before the current one.
+    std::string_view total_label = "Addresses";
+    std::size_t total = 0;
+    std::size_t listed = 0; // addresses already printed.
+};
+
+Listing last_listing;
+std::size_t listing_limit = 1000; // addresses printed per page, 0 for all.
+
+template <typename T>
+void append_val(OutputBuffer& out, const std::optional<T>& val)
 {
-    for (auto address : addresses)
+    if (!val)
     {
-        print_hex(address);
-        std::cout << '\n';
+        out << "Inaccessible";
+        return;
+    }
+
+    out.number(*val);
+    // If the value is an int, additionally print out a hex representation.
+    if constexpr(std::is_integral_v<T>)
+    {
+        out << "\t( ";
+        out.hex(*val);
+        out << " )";
+    }
+}
+
+// Decodes up to 'count' offsets of a candidate set, starting at its first'th.
+std::vector<std::uintptr_t> decode_range(const CandidateSet& set, std::size_t first, std::size_t count)
+{
+    std::vector<std::uintptr_t> offsets;
+    std::vector<std::uintptr_t> block_offsets;
+    auto blocks = set.get_blocks();
+    std::size_t block_first = 0;
+    for (std::size_t i = 0; i < blocks.size() and offsets.size() < count; ++i)
+    {
+        const std::size_t block_end = block_first + blocks[i].count;
+        if (block_end > first)
+        {
+            block_offsets.clear();
+            set.decode_block(i, block_offsets);
+            const std::size_t from = first > block_first ? first - block_first : 0;
+            const std::size_t take = std::min(block_offsets.size() - from, count - offsets.size());
+            offsets.insert(offsets.end(), block_offsets.begin() + from, block_offsets.begin() + from + take);
+        }
+        block_first = block_end;
+    }
+    return offsets;
+}
+
+// Writes one row per offset of a set of the listing, as on screen or as CSV. Values are read in one batched pass.
+template <typename T>
+void write_rows(OutputBuffer& out, Scanner& scanner, const Listing& listing, std::string_view header, std::span<const std::uintptr_t> offsets, bool csv)
+{
+    std::vector<std::optional<T>> vals;
+    if (listing.with_values)
+    {
+        vals.resize(offsets.size());
+        scanner.read_values<T>(offsets, [&](std::size_t index, std::uintptr_t, std::optional<T> val)
+        {
+            vals[index] = val;
+        });
     }
-    std::cout << "Addresses: " << addresses.size() << '\n';
+
+    for (std::size_t i = 0; i < offsets.size(); ++i)
+    {
+        if (csv)
+        {
+            if (!listing.headers.empty())
+                out << header << ',';
+            out.hex(offsets[i]);
+            if (listing.with_types or listing.with_values)
+                out << ',' << type_name<T>();
+            if (listing.with_values)
+            {
+                out << ',';
+                if (vals[i])
+                    out.number(*vals[i]);
+            }
+            out << '\n';
+            continue;
+        }
+
+        out.hex(offsets[i]);
+        if (listing.with_types)
+            out << ' ' << type_name<T>();
+        if (listing.prev_val)
+        {
+            out << " : ";
+            out.number(listing.prev_val->get<T>());
+            out << "\t->\t";
+            append_val(out, vals[i]);
+        }
+        else if (listing.with_values)
+        {
+            out << " => ";
+            append_val(out, vals[i]);
+        }
+        out << '\n';
+    }
+}
+
+// Writes the listing's addresses [first, first + count), decoded and read a chunk at a time.
+void write_listing(OutputBuffer& out, Scanner& scanner, const Listing& listing, std::size_t first, std::size_t count, bool csv)
+{
+    constexpr std::size_t chunk_size = 16384;
+
+    std::size_t set_first = 0;
+    for (std::size_t set = 0; set < listing.sets.size(); ++set)
+    {
+        const ListedSet& listed = listing.sets[set];
+        const std::string_view header = listing.headers.empty() ? std::string_view{} : listing.headers[set];
+        const std::size_t from = std::max(first, set_first);
+        const std::size_t to = std::min(first + count, set_first + listed.offsets->size());
+        if (!csv and !header.empty() and from == set_first and from < to)
+            out << header << ":\n";
+
+        for (std::size_t chunk = from; chunk < to; chunk += chunk_size)
+        {
+            const std::vector<std::uintptr_t> offsets = decode_range(*listed.offsets, chunk - set_first, std::min(chunk_size, to - chunk));
+            listed.tag.visit([&](auto tag)
+            {
+                write_rows<decltype(tag)>(out, scanner, listing, header, offsets, csv);
+            });
+        }
+        set_first += listed.offsets->size();
+    }
+}
+
+// Prints the next page of the last listing (see limit), then how many addresses are left.
+void print_listing_page(Scanner& scanner)
+{
+    Listing& listing = last_listing;
+    const std::size_t left = listing.total - listing.listed;
+    const std::size_t count = listing_limit == 0 ? left : std::min(listing_limit, left);
+
+    OutputBuffer out { std::cout };
+    write_listing(out, scanner, listing, listing.listed, count, false);
+    listing.listed += count;
+    if (listing.listed < listing.total)
+    {
+        out << "... (";
+        out.number(listing.total - listing.listed);
+        out << " more, 'more' lists them)\n";
+    }
+}
+
+// Makes 'listing' the last listing, prints its first page and its totals. Moving the listing keeps its found sets
+// where its views point.
+void list_addresses(Scanner& scanner, Listing listing)
+{
+    listing.total = 0;
+    for (const ListedSet& listed : listing.sets)
+    {
+        listing.total += listed.offsets->size();
+    }
+    last_listing = std::move(listing);
+    print_listing_page(scanner);
+
+    const Listing& listed = last_listing;
+    if (listed.with_types or listed.sets.size() > 1)
+    {
+        for (std::size_t set = 0; set < listed.sets.size(); ++set)
+        {
+            if (!listed.headers.empty())
+            {
+                std::cout << listed.headers[set];
+            }
+            else
+            {
+                listed.sets[set].tag.visit([](auto val){ std::cout << type_name<decltype(val)>(); });
+            }
+            std::cout << ": " << listed.sets[set].offsets->size() << '\n';
+        }
+    }
+    std::cout << listed.total_label << ": " << listed.total << '\n';
+}
+
+template <typename T>
+Value type_tag()
+{
+    Value tag;
+    tag = T{};
+    return tag;
+}
+
+// Prints addresses of the where chain.
+void print_addresses(Scanner& scanner, const CandidateSet& addresses)
+{
+    Listing listing;
+    listing.sets.push_back({ type_tag<uint8_t>(), &addresses });
+    list_addresses(scanner, std::move(listing));
+}
+
+// Prints addresses found outside the where chain, which the listing keeps.
+void print_found_addresses(Scanner& scanner, CandidateSet addresses)
+{
+    Listing listing;
+    listing.found.push_back(std::move(addresses));
+    listing.sets.push_back({ type_tag<uint8_t>(), &listing.found.back() });
+    list_addresses(scanner, std::move(listing));
+}
+
+template <typename T>
+void print_addresses_with_values(Scanner& scanner, const CandidateSet& addresses)
+{
+    Listing listing;
+    listing.sets.push_back({ type_tag<T>(), &addresses });
+    listing.with_values = true;
+    list_addresses(scanner, std::move(listing));
+}
+
+// Prints the addresses of every type of a chain started with where [value] *, tagged with their type.
+void print_typed_addresses(Scanner& scanner, const std::vector<TypedCandidates>& typed_addresses, bool with_values)
+{
+    Listing listing;
+    for (const TypedCandidates& typed : typed_addresses)
+    {
+        listing.sets.push_back({ typed.val, &typed.offsets });
+    }
+    listing.with_types = true;
+    listing.with_values = with_values;
+    list_addresses(scanner, std::move(listing));
 }
 
 void handle_where_became(Scanner& scanner, ArgList args)
@@ -94,22 +445,40 @@ void handle_where_became(Scanner& scanner, ArgList args)
     }
 
     auto val_str = args.front();
+    const PredicateSyntax* syntax = find_predicate_syntax(val_str);
+    if (cur_where_type == all_types)
+    {
+        const std::vector<Value> vals = convert_all_types(val_str, true);
+        if (syntax)
+            std::cout << "A chain of several types is filtered only by value.\n";
+        else if (vals.empty())
+            std::cout << "Invalid value.\n";
+        else
+            print_typed_addresses(scanner, scanner.where_vals_became(vals), true);
+        return;
+    }
+
+    if (syntax)
+    {
+        if (args.size() <= syntax->num_values or (syntax->kind == PredicateKind::mask and is_float_type(cur_where_type)))
+        {
+            return;
+        }
+
+        std::visit([&](auto&& type)
+        {
+            using T = std::decay_t<decltype(type)>;
+            print_addresses_with_values<T>(scanner, scanner.where_became_matching(make_predicate<T>(*syntax, args.subspan(1), cur_where_type)));
+        }, convert_type(cur_where_type));
+        return;
+    }
+
     ValueType val = convert_value(val_str, cur_where_type);
 
     std::visit([&scanner](auto&& val)
     {
        using T = std::decay_t<decltype(val)>;
-       std::span<const std::uintptr_t> addresses = scanner.where_became(val);
-
-       for (std::uintptr_t address : addresses)
-       {
-           print_hex(address);
-           std::cout << " => ";
-           print_val(scanner.read_mem<T>(address));
-           std::cout << '\n';
-       }
-
-       std::cout << "Addresses: " << addresses.size() << '\n';
+       print_addresses_with_values<T>(scanner, scanner.where_became(val));
     }, val);
 }
 
@@ -123,65 +492,254 @@ void handle_where(Scanner& scanner, ArgList args)
     // Starting 'where' command chain does a full scan, so print something out to acknowledge command before doing so.
     std::cout << "Scanning...\n";
 
-    // Handle where string search
-    if (args[0][0] == '\'')
+    // Handle where string search, optionally preceded by the -w (UTF-16) and -i (case insensitive) flags.
+    auto str_it = std::find_if(args.begin(), args.end(), [](std::string_view arg){ return arg[0] == '\''; });
+    auto is_string_flag = [](std::string_view arg){ return arg == "-w" or arg == "-i"; };
+    if (str_it != args.end() and std::all_of(args.begin(), str_it, is_string_flag))
     {
+        StringSearchOptions options;
+        options.utf16 = std::find(args.begin(), str_it, "-w") != str_it;
+        options.case_insensitive = std::find(args.begin(), str_it, "-i") != str_it;
+
         const char* end = args.back().end();
-        std::string_view whole_str { args[0].data() + 1, end };
+        std::string_view whole_str { str_it->data() + 1, end };
 
-        auto addresses = scanner.where_val(whole_str);
-        print_addresses(addresses);
+        print_found_addresses(scanner, scanner.where_val(whole_str, options));
     }
     else
     {
+        // where [predicate] [values] (type): the values run up to the type.
+        if (const PredicateSyntax* syntax = find_predicate_syntax(args.front()))
+        {
+            if (args.size() <= syntax->num_values)
+            {
+                return;
+            }
+
+            cur_where_type = args.size() > syntax->num_values + 1 ? args[syntax->num_values + 1] : "i";
+            if (cur_where_type == all_types or (syntax->kind == PredicateKind::mask and is_float_type(cur_where_type)))
+            {
+                std::cout << "Predicate not supported for type " << cur_where_type << ".\n";
+                cur_where_type = "i";
+                return;
+            }
+
+            std::visit([&](auto&& type)
+            {
+                using T = std::decay_t<decltype(type)>;
+                const CandidateSet& addresses = scanner.where_matching(make_predicate<T>(*syntax, args.subspan(1), cur_where_type));
+                print_addresses(scanner, addresses);
+            }, convert_type(cur_where_type));
+
+            std::cout << "Finished.\n";
+            return;
+        }
+
         // Use type if provided, default to int (4 byte int).
-        cur_where_type = args.size() > 1 ? args[1] : "i";
+        std::string_view type = args.size() > 1 ? args[1] : "i";
         std::string_view val_str = args.front();
 
+        if (type == all_types)
+        {
+            // Rejected before cur_where_type changes, so the current chain can go on.
+            const std::vector<Value> vals = convert_all_types(val_str);
+            if (val_str == "?" or vals.empty())
+            {
+                std::cout << (val_str == "?" ? "An unknown value needs a single type.\n" : "Invalid value.\n");
+                return;
+            }
+
+            cur_where_type = type;
+            const bool unaligned = args.size() > 2 and args[2] == "-u";
+            print_typed_addresses(scanner, scanner.where_vals(vals, unaligned), false);
+            std::cout << "Finished.\n";
+            return;
+        }
+
+        cur_where_type = type;
+        if (val_str == "?")
+        {
+            std::visit([&scanner](auto&& type)
+            {
+                using T = std::decay_t<decltype(type)>;
+                const CandidateSet& addresses = scanner.where_unknown<T>();
+                last_listing = {}; // it may view the chain this replaced.
+                std::cout << "Addresses: " << addresses.size() << '\n';
+                std::cout << "Snapshot: " << scanner.snapshot_memory_usage() / 1024 << " KiB\n";
+            }, convert_type(cur_where_type));
+
+            std::cout << "Finished.\n";
+            return;
+        }
+
         ValueType val = convert_value(val_str, cur_where_type);
 
         std::visit([&scanner](auto&& val)
         {
-            std::span<const std::uintptr_t> addresses = scanner.where_val(val);
-            print_addresses(addresses);
+            const CandidateSet& addresses = scanner.where_val(val);
+            print_addresses(scanner, addresses);
         }, val);
     }
 
     std::cout << "Finished.\n";
 }
 
-void handle_possible_pointer(Scanner& scanner, std::uintptr_t possible_pointer)
+// Parses a struct field: offset:type followed by =value, !=value, >value, <value or =low..high, or offset:p for a
+// pointer. Returns nullopt if the field is malformed.
+std::optional<StructPattern::Field> parse_struct_field(std::string_view field_str)
 {
-    constexpr int num_elements = 8;
-    auto relative_pointer = scanner.get_relative_address(possible_pointer);
-    auto try_to_read = scanner.read_array<char>(relative_pointer, num_elements);
+    const auto colon = field_str.find(':');
+    if (colon == std::string_view::npos or colon + 1 == field_str.size())
+    {
+        return {};
+    }
 
-    if (try_to_read)
+    StructPattern::Field field { lexical_cast<std::size_t>(field_str.substr(0, colon)), StructPattern::Pointer{} };
+    std::string_view rest = field_str.substr(colon + 1);
+    if (rest == "p")
     {
-        // We were able to deref possible_pointer, indicate that it is a pointer and the relative address.
-        std::cout << " => (relative: ";
-        print_hex(relative_pointer);
-        std::cout << ")";
+        return field;
+    }
+
+    const auto op_pos = rest.find_first_of("=!<>");
+    if (op_pos == std::string_view::npos or op_pos == 0)
+    {
+        return {};
+    }
+    const std::string_view type = rest.substr(0, op_pos);
+
+    PredicateKind kind;
+    std::string_view val_str = rest.substr(op_pos + 1);
+    switch (rest[op_pos])
+    {
+        case '>': kind = PredicateKind::greater; break;
+        case '<': kind = PredicateKind::less; break;
+        case '!':
+            if (val_str.empty() or val_str[0] != '=')
+                return {};
+            val_str.remove_prefix(1);
+            kind = PredicateKind::not_equal;
+            break;
+        default: kind = PredicateKind::equal; break;
+    }
+
+    std::string_view high_str;
+    const auto range_pos = val_str.find("..");
+    if (kind == PredicateKind::equal and range_pos != std::string_view::npos)
+    {
+        kind = PredicateKind::between;
+        high_str = val_str.substr(range_pos + 2);
+        val_str = val_str.substr(0, range_pos);
+    }
+    if (val_str.empty())
+    {
+        return {};
+    }
+
+    // Copied so the float conversion stops at the end of the value, not at the end of the line.
+    std::visit([&](auto&& low)
+    {
+        using T = std::decay_t<decltype(low)>;
+        ValuePredicate<T> pred { kind, low };
+        if (kind == PredicateKind::between)
+            pred.b = std::get<T>(convert_value(std::string{ high_str }, type));
+        field.test = pred;
+    }, convert_value(std::string{ val_str }, type));
+
+    return field;
+}
+
+void handle_struct(Scanner& scanner, ArgList args)
+{
+    if (args.empty())
+    {
+        return;
+    }
 
-        // If dereferences to a possible string, print it.
-        auto is_printable = [](unsigned char byte){ return std::isprint(byte); };
-        auto end_printable = std::find_if_not(try_to_read.get(), try_to_read.get() + num_elements, is_printable);
-        std::size_t num_printable_chars = end_printable - try_to_read.get();
-        if (num_printable_chars > 0)
+    StructPattern pattern;
+    for (std::string_view arg : args)
+    {
+        auto field = parse_struct_field(arg);
+        if (!field)
         {
-            std::string_view str { try_to_read.get(), num_printable_chars };
-            std::cout << " -> *(";
-            std::cout << str;
-            std::cout << ")";
+            std::cout << "Could not parse field " << arg << ".\n";
+            return;
         }
+        pattern.fields.push_back(std::move(*field));
     }
-    else
+
+    if (std::all_of(pattern.fields.begin(), pattern.fields.end(), [](const StructPattern::Field& field){ return std::holds_alternative<StructPattern::Pointer>(field.test); }))
+    {
+        std::cout << "At least one field needs a value.\n";
+        return;
+    }
+
+    std::cout << "Scanning...\n";
+    print_found_addresses(scanner, scanner.where_struct(pattern));
+    std::cout << "Finished.\n";
+}
+
+void handle_aob(Scanner& scanner, ArgList args)
+{
+    if (args.empty())
+    {
+        return;
+    }
+
+    // Signatures are separated by |, e.g. aob 48 8B 05 ?? ?? ?? ?? | E8 ?? ?? ?? ?? 90
+    std::vector<Signature> signatures;
+    std::string_view whole { args.front().data(), args.back().end() };
+    while (!whole.empty())
+    {
+        const std::size_t bar = whole.find('|');
+        const std::string_view text = whole.substr(0, bar);
+        try
+        {
+            signatures.emplace_back(text);
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cout << e.what() << '\n';
+            return;
+        }
+        whole = bar == std::string_view::npos ? std::string_view{} : whole.substr(bar + 1);
+    }
+
+    std::cout << "Scanning...\n";
+    std::vector<CandidateSet> found = scanner.where_signatures(signatures);
+    Listing listing;
+    listing.found = std::move(found);
+    for (std::size_t i = 0; i < listing.found.size(); ++i)
+    {
+        listing.sets.push_back({ type_tag<uint8_t>(), &listing.found[i] });
+        if (listing.found.size() > 1)
+            listing.headers.push_back("Signature " + std::to_string(i + 1));
+    }
+    list_addresses(scanner, std::move(listing));
+    std::cout << "Finished.\n";
+}
+
+void handle_possible_pointer(Scanner& scanner, std::uintptr_t possible_pointer, std::string_view pointed_bytes)
+{
+    // possible_pointer points to readable memory, indicate that it is a pointer and the relative address.
+    auto relative_pointer = scanner.get_relative_address(possible_pointer);
+    std::cout << " => (relative: ";
+    print_hex(relative_pointer);
+    std::cout << ")";
+
+    // If dereferences to a possible string, print it.
+    auto is_printable = [](unsigned char byte){ return std::isprint(byte); };
+    auto end_printable = std::find_if_not(pointed_bytes.begin(), pointed_bytes.end(), is_printable);
+    std::size_t num_printable_chars = end_printable - pointed_bytes.begin();
+    if (num_printable_chars > 0)
     {
-        // do nothing, unreadable memory, cannot possibly be a pointer.
+        std::cout << " -> *(";
+        std::cout << pointed_bytes.substr(0, num_printable_chars);
+        std::cout << ")";
     }
 }
 
-void print_pointer_map(const std::unordered_map<std::uintptr_t, std::vector<std::uintptr_t>>& pointer_map, std::uintptr_t address, int level)
+void print_pointer_graph(const PointerGraph& graph, const PointerGraph::Node& node, int level)
 {
     auto align_level = [](int level)
     {
@@ -191,15 +749,21 @@ void print_pointer_map(const std::unordered_map<std::uintptr_t, std::vector<std:
         }
     };
 
-    const auto& pointers = pointer_map.at(address);
-
-    for (auto pointer : pointers)
+    for (const auto& pointer : graph.children(node))
     {
         align_level(level);
         std::cout << "<- ";
-        print_hex(pointer);
+        print_hex(pointer.offset);
+        if (pointer.seen_before)
+        {
+            std::cout << " (already listed)";
+        }
+        else if (pointer.depth_limited)
+        {
+            std::cout << " (...)";
+        }
         std::cout << '\n';
-        print_pointer_map(pointer_map, pointer, level + 1);
+        print_pointer_graph(graph, pointer, level + 1);
     }
 }
 
@@ -212,15 +776,20 @@ void handle_pointer_scan(Scanner& scanner, ArgList args)
 
     std::string_view str_address = args[0];
     std::string_view opt_type = args.size() == 1 ? "i" : args[1];
-    int range = args.size() == 3 ? std::max(lexical_cast<int>(args[2]), 1) : 1;
+    int range = args.size() >= 3 ? std::max(lexical_cast<int>(args[2]), 1) : 1;
+    int max_depth = args.size() >= 4 ? std::max(lexical_cast<int>(args[3]), 1) : 5;
 
     auto offset = lexical_cast<std::uintptr_t>(str_address);
 
     std::cout << "Scanning...\n";
 
+    // Memory may have changed since the last command, index it once for all addresses in the range.
+    const PointerIndex& index = scanner.build_pointer_index();
+    std::cout << "Indexed pointers: " << index.num_pointers() << '\n';
+
     ValueType type = convert_type(opt_type);
 
-    std::visit([&scanner, offset, range](auto&& type)
+    std::visit([&scanner, offset, range, max_depth](auto&& type)
     {
         using T = std::decay_t<decltype(type)>;
 
@@ -231,14 +800,82 @@ void handle_pointer_scan(Scanner& scanner, ArgList args)
         {
             print_hex(i);
             std::cout << "\n";
-            auto pointer_map = scanner.scan_pointers_to(i);
-            print_pointer_map(pointer_map, i, 1);
+            PointerGraph graph = scanner.scan_pointers_to(i, max_depth);
+            print_pointer_graph(graph, graph.root(), 1);
         }
     }, type);
 
     std::cout << "Finished.\n";
 }
 
+void print_pointer_path(std::uintptr_t static_offset, std::span<const std::uintptr_t> offsets)
+{
+    for (std::size_t i = 0; i < offsets.size(); ++i)
+    {
+        std::cout << '[';
+    }
+    std::cout << "base+";
+    print_hex(static_offset);
+    for (std::uintptr_t offset : offsets)
+    {
+        std::cout << "]+";
+        print_hex(offset);
+    }
+    std::cout << '\n';
+}
+
+void handle_pointer_path_scan(Scanner& scanner, ArgList args)
+{
+    if (args.empty())
+    {
+        return;
+    }
+
+    constexpr std::size_t max_printed = 20;
+
+    auto offset = lexical_cast<std::uintptr_t>(args[0]);
+    PointerPathOptions options;
+    if (args.size() >= 2)
+        options.max_depth = std::max(lexical_cast<int>(args[1]), 1);
+    if (args.size() >= 3)
+        options.max_offset = lexical_cast<std::uintptr_t>(args[2]);
+
+    std::optional<PointerPathWriter> writer;
+    if (args.size() >= 4)
+    {
+        writer.emplace(std::string{ args[3] }, scanner.is_64_bit() ? 8 : 4, options, offset);
+    }
+
+    std::cout << "Scanning...\n";
+
+    const PointerIndex& index = scanner.build_pointer_index();
+    std::cout << "Indexed pointers: " << index.num_pointers() << '\n';
+
+    std::size_t num_paths = 0;
+    scanner.find_pointer_paths(offset, options, [&](std::uintptr_t static_offset, std::span<const std::uintptr_t> offsets)
+    {
+        if (num_paths++ < max_printed)
+        {
+            print_pointer_path(static_offset, offsets);
+        }
+        if (writer)
+        {
+            writer->write(static_offset, offsets);
+        }
+    });
+
+    if (num_paths > max_printed)
+    {
+        std::cout << "... (" << num_paths - max_printed << " more)\n";
+    }
+    std::cout << "Paths: " << num_paths << '\n';
+    if (writer)
+    {
+        std::cout << "Written to " << args[3] << '\n';
+    }
+    std::cout << "Finished.\n";
+}
+
 void handle_scan(Scanner& scanner, ArgList args)
 {
     if (args.empty())
@@ -281,6 +918,19 @@ void handle_scan(Scanner& scanner, ArgList args)
             return;
         }
 
+        // Classify all values at once and read what the pointers point to in one batch.
+        std::vector<std::optional<std::string>> pointed_bytes;
+        if constexpr (std::is_integral_v<T>)
+        {
+            if (scanner.is_sizeof_pointer(T{}))
+            {
+                constexpr std::size_t preview_size = 8;
+                scanner.refresh_regions();
+                std::vector<std::uintptr_t> pointers { vals.get(), vals.get() + num_elements };
+                pointed_bytes = scanner.deref_pointers(pointers, preview_size);
+            }
+        }
+
         for (int i = 0; i < num_elements; ++i)
         {
             auto val = vals[i];
@@ -289,9 +939,9 @@ void handle_scan(Scanner& scanner, ArgList args)
             std::cout << " - ";
             print_val(val);
 
-            if (scanner.is_possible_pointer(val))
+            if (!pointed_bytes.empty() and pointed_bytes[i])
             {
-                handle_possible_pointer(scanner, val);
+                handle_possible_pointer(scanner, val, *pointed_bytes[i]);
             }
 
             std::cout << "\n";
@@ -302,24 +952,188 @@ void handle_scan(Scanner& scanner, ArgList args)
 
 void handle_where_changed(Scanner& scanner, ArgList args)
 {
+    if (cur_where_type == all_types)
+    {
+        if (args.empty())
+            print_typed_addresses(scanner, scanner.where_vals_changed(), true);
+        else
+            std::cout << "A chain of several types is filtered only with became and changed.\n";
+        return;
+    }
+
     ValueType type = convert_type(cur_where_type);
+
+    // 'changed [amount]' keeps values that changed by exactly that amount.
+    if (!args.empty())
+    {
+        std::visit([&scanner](auto&& by)
+        {
+            using T = std::decay_t<decltype(by)>;
+            print_addresses_with_values<T>(scanner, scanner.where_change_filter(ChangeFilter::changed_by, by));
+        }, convert_value(args.front(), cur_where_type));
+        return;
+    }
+
     std::visit([&scanner](auto&& type)
     {
         using T = std::decay_t<decltype(type)>;
 
-        auto prev_val = scanner.get_where_chain_val<T>();
-        std::span<const std::uintptr_t> addresses = scanner.where_changed<T>();
-        for (const auto change : addresses)
+        if (scanner.has_snapshot())
         {
-            print_hex(change);
-            std::cout << " : " << prev_val << "\t->\t";
-            print_val(scanner.read_mem<T>(change));
-            std::cout << '\n';
+            // Values differ per address, there is no single previous value to print.
+            print_addresses_with_values<T>(scanner, scanner.where_changed<T>());
+            return;
         }
-        std::cout << "Addresses changed: " << addresses.size() << '\n';
+
+        Listing listing;
+        listing.prev_val = type_tag<T>();
+        *listing.prev_val = scanner.get_where_chain_val<T>();
+        listing.sets.push_back({ type_tag<T>(), &scanner.where_changed<T>() });
+        listing.with_values = true;
+        listing.total_label = "Addresses changed";
+        list_addresses(scanner, std::move(listing));
     }, type);
 }
 
+void handle_change_filter(Scanner& scanner, ChangeFilter filter)
+{
+    if (cur_where_type == all_types)
+    {
+        std::cout << "A chain of several types is filtered only with became and changed.\n";
+        return;
+    }
+
+    std::visit([&scanner, filter](auto&& type)
+    {
+        using T = std::decay_t<decltype(type)>;
+        print_addresses_with_values<T>(scanner, scanner.where_change_filter<T>(filter));
+    }, convert_type(cur_where_type));
+}
+
+void handle_where_increased(Scanner& scanner, ArgList args)
+{
+    handle_change_filter(scanner, ChangeFilter::increased);
+}
+
+void handle_where_decreased(Scanner& scanner, ArgList args)
+{
+    handle_change_filter(scanner, ChangeFilter::decreased);
+}
+
+void handle_where_unchanged(Scanner& scanner, ArgList args)
+{
+    handle_change_filter(scanner, ChangeFilter::unchanged);
+}
+
+void handle_track(Scanner& scanner, ArgList args)
+{
+    if (!args.empty())
+    {
+        const bool enable = args[0] == "on";
+        if (scanner.set_dirty_tracking(enable) != enable)
+        {
+            std::cout << "Dirty page tracking is not supported for this process.\n";
+        }
+    }
+
+    std::cout << "Dirty page tracking: " << (scanner.is_dirty_tracking() ? "on" : "off") << '\n';
+}
+
+void handle_snapshot(Scanner& scanner, ArgList args)
+{
+    if (args.empty())
+    {
+        return;
+    }
+
+    const bool compress = args.size() >= 2 and args[1] == "-z";
+
+    std::cout << "Writing snapshot...\n";
+    std::size_t bytes = scanner.write_snapshot(std::string{ args[0] }, compress);
+    std::cout << "Stored " << bytes / 1024 << " KiB of memory in " << args[0] << '\n';
+}
+
+void handle_limit(Scanner& scanner, ArgList args)
+{
+    if (!args.empty())
+    {
+        listing_limit = lexical_cast<std::size_t>(args[0]);
+    }
+
+    std::cout << "Addresses listed at a time: ";
+    if (listing_limit == 0)
+        std::cout << "all\n";
+    else
+        std::cout << listing_limit << '\n';
+}
+
+void handle_more(Scanner& scanner, ArgList args)
+{
+    if (last_listing.listed == last_listing.total)
+    {
+        std::cout << "No more addresses.\n";
+        return;
+    }
+
+    print_listing_page(scanner);
+}
+
+// Writes every address of the last listing to a file. Binary: "MAAD", u32 version (1), u32 number of sets, then per
+// set u64 count and its u64 offsets, in the host's byte order. CSV: a header line, then one line per address with its
+// set (signatures), type and current value where the listing has them.
+void handle_dump(Scanner& scanner, ArgList args)
+{
+    if (args.empty())
+    {
+        return;
+    }
+
+    const bool csv = args.size() >= 2 and args[1] == "-csv";
+    std::ofstream file { std::string{ args[0] }, csv ? std::ios::trunc : std::ios::binary | std::ios::trunc };
+    if (!file)
+    {
+        std::cout << "Could not open file " << args[0] << ".\n";
+        return;
+    }
+
+    const Listing& listing = last_listing;
+    {
+        OutputBuffer out { file };
+        if (csv)
+        {
+            if (!listing.headers.empty())
+                out << "set,";
+            out << "address";
+            if (listing.with_types or listing.with_values)
+                out << ",type";
+            if (listing.with_values)
+                out << ",value";
+            out << '\n';
+            write_listing(out, scanner, listing, 0, listing.total, true);
+        }
+        else
+        {
+            out << "MAAD";
+            out.raw(std::uint32_t{ 1 });
+            out.raw(static_cast<std::uint32_t>(listing.sets.size()));
+            for (const ListedSet& listed : listing.sets)
+            {
+                out.raw(static_cast<std::uint64_t>(listed.offsets->size()));
+                for (std::uintptr_t offset : *listed.offsets)
+                    out.raw(static_cast<std::uint64_t>(offset));
+            }
+        }
+    }
+
+    std::cout << "Wrote " << listing.total << " addresses to " << args[0] << '\n';
+}
+
+void handle_stats(Scanner& scanner, ArgList args)
+{
+    scanner.get_stats().write_report(std::cout);
+    std::cout << '\n';
+}
+
 void print_help_message(Scanner& scanner, ArgList args)
 {
     std::cout << "Types:\n";
@@ -333,21 +1147,58 @@ void print_help_message(Scanner& scanner, ArgList args)
     std::cout << "t: string (used only by the scan command)\n\n";
 
     std::cout << "Commands:\n";
-    std::cout << "where [value] (type)\n";
+    std::cout << "where [value] (type) (-u)\n";
+    std::cout << "where (-w) (-i) '[string]\n";
     std::cout << "\tAlias: w\n";
     std::cout << "\tPrints a list of addresses where the value is located.\n";
     std::cout << "\tIf the value begins with an apostrophe ('), the value and all subsequent characters will be interpreted as a string.\n";
-    std::cout << "\tIf the value is not a string, this command starts a chain and can be used with multiple 'became' commands or one 'changed' command.\n\n";
+    std::cout << "\tA string can be preceded by -w to search for its UTF-16 (wide) encoding and/or -i to ignore letter case.\n";
+    std::cout << "\tIf the value is not a string, this command starts a chain and can be used with multiple 'became' commands or one 'changed' command.\n";
+    std::cout << "\tIf the value is ?, starts a chain for an unknown value: all of memory is snapshotted for the filters below (not with type *).\n";
+    std::cout << "\tIf the type is *, the value is searched as every type it fits in one pass; each address is listed with its type.\n";
+    std::cout << "\t\tAdd -u to also match at unaligned addresses. Such a chain is filtered with became and changed only.\n\n";
+
+    std::cout << "where != / > / < [value] (type)\n";
+    std::cout << "where between [low] [high] (type)\n";
+    std::cout << "where mask [bits] [value] (type)\n";
+    std::cout << "where ulps [value] [steps] (type)\n";
+    std::cout << "\tStarts a chain with the values that differ from / are greater than / are less than [value], lie within [low, high],\n";
+    std::cout << "\t\tmatch [value] in the given bits (integers only), or lie within [steps] units in the last place of [value]\n";
+    std::cout << "\t\t(for integers, within [steps] of it).\n";
+    std::cout << "\tThe values found are snapshotted, so the chain can continue with any of the filters below.\n\n";
 
     std::cout << "became [value]\n";
     std::cout << "\tAlias: b\n";
-    std::cout << "\tFilters the current addresses located by where, prints addresses where the value is now [value].\n\n";
+    std::cout << "\tFilters the current addresses located by where, prints addresses where the value is now [value].\n";
+    std::cout << "\tAccepts the predicates of where in place of [value], e.g. became between 10 20.\n\n";
 
     std::cout << "changed\n";
     std::cout << "\tAlias: c\n";
     std::cout << "\tFilters the current addresses located by where, prints addresses where the value is different from the initial value.\n";
     std::cout << "\tThis command is particularly useful for finding floating point numbers.\n";
-    std::cout << "\tFinishes the 'where' chain.\n\n";
+    std::cout << "\tFinishes the 'where' chain, unless the chain started with an unknown value.\n\n";
+
+    std::cout << "changed [amount]\n";
+    std::cout << "\tFilters the current addresses, keeping values that changed by exactly [amount] since the previous step.\n\n";
+
+    std::cout << "increased / decreased / unchanged\n";
+    std::cout << "\tAliases: + / - / =\n";
+    std::cout << "\tFilters the current addresses, keeping values that increased / decreased / did not change since the previous step.\n\n";
+
+    std::cout << "struct [offset]:[type][test] ...\n";
+    std::cout << "\tPrints the addresses of structs whose fields at the given offsets all pass their tests, in a single scan.\n";
+    std::cout << "\tA test is =value, !=value, >value, <value or =low..high; a field of type p holds a pointer to readable memory.\n";
+    std::cout << "\tExample: struct 0:i=42 8:f=0..100 16:p\n\n";
+
+    std::cout << "aob [bytes] (| [bytes] ...)\n";
+    std::cout << "\tPrints the addresses where the byte signature is found, code included. A byte is two hex digits, ?? matches any\n";
+    std::cout << "\t\tbyte and a ? digit any nibble. Several signatures separated by | are searched in a single scan.\n";
+    std::cout << "\tExample: aob 48 8B 05 ?? ?? ?? ?? 48 85 C0\n\n";
+
+    std::cout << "track (on / off)\n";
+    std::cout << "\tTurns dirty page tracking on or off, or shows whether it is on (Linux only, off by default).\n";
+    std::cout << "\tWhile on, chain steps only re-read addresses on pages the process wrote to since the previous step.\n";
+    std::cout << "\tTracking resets the process's soft dirty bits, which can interfere with other tools using them.\n\n";
 
     std::cout << "scan [address] (type) (range = 1) \n";
     std::cout << "\tAlias: s\n";
@@ -357,10 +1208,40 @@ void print_help_message(Scanner& scanner, ArgList args)
     std::cout << "\t\twill additionally indicate whether the value is potentially a pointer.\n";
     std::cout << "\t\tIf the pointer points to a printable string, will additionally print the first few characters of that string.\n\n";
 
-    std::cout << "pointers [address] (type) (range = 0) \n";
+    std::cout << "pointers [address] (type) (range = 0) (depth = 5)\n";
     std::cout << "\tAlias: p\n";
-    std::cout << "\tSearches for possible pointers to the given address, then recursively searches for pointers to those pointers.\n";
-    std::cout << "\tA range can be given to additionally scan for pointers to addresses at offsets equal to the given type's byte size above the given address.\n";
+    std::cout << "\tSearches for possible pointers to the given address, then recursively searches for pointers to those pointers, up to depth levels.\n";
+    std::cout << "\tAddresses reached a second time (e.g. through a cycle) are not expanded again.\n";
+    std::cout << "\tA range can be given to additionally scan for pointers to addresses at offsets equal to the given type's byte size above the given address.\n\n";
+
+    std::cout << "paths [address] (depth = 5) (max offset = 0x400) (file)\n";
+    std::cout << "\tAlias: pp\n";
+    std::cout << "\tSearches for pointer paths like [[base+0x1A0]+0x18]+0x40 that lead from the executable's image to the given address,\n";
+    std::cout << "\t\tfollowing up to depth pointers and adding at most max offset to each.\n";
+    std::cout << "\tThe first paths found are printed. If a file is given, all paths are written to it in binary.\n\n";
+
+    std::cout << "snapshot [file] (-z)\n";
+    std::cout << "\tWrites all scanned memory to a snapshot file, compressed with -z.\n";
+    std::cout << "\tStart with -f [file] to scan a snapshot or ELF core dump instead of the process.\n\n";
+
+    std::cout << "limit (count)\n";
+    std::cout << "\tSets how many addresses a command lists at a time (1000 by default, 0 for all), or shows it.\n\n";
+
+    std::cout << "more\n";
+    std::cout << "\tLists the next addresses of the last command that listed addresses.\n\n";
+
+    std::cout << "dump [file] (-csv)\n";
+    std::cout << "\tWrites every address of the last listing to a file, in binary or, with -csv, as CSV with types and current values.\n\n";
+
+    std::cout << "stats\n";
+    std::cout << "\tShows where the time of the previous command went (region map, reads, compares, filtering, printing),\n";
+    std::cout << "\t\tand how many bytes and reads it took.\n";
+    std::cout << "\tStart with --trace [prefix] to write every command's timeline to [prefix][n].json, for chrome://tracing or Perfetto.\n\n";
+
+    std::cout << "cancel\n";
+    std::cout << "\tStops the running command, as does Ctrl-C. A cancelled step leaves the where chain as it was before it.\n";
+    std::cout << "\tCommands run in the background in the order entered; while a scan runs, its first matches\n";
+    std::cout << "\t\tand its progress are shown on stderr.\n\n";
 
     std::cout << "quit\n";
     std::cout << "\tAlias: q\n";
@@ -382,7 +1263,11 @@ void print_intro(Scanner& scanner)
     std::cout << scanner.get_process_name() << '\n';
     std::cout << "ID: " << scanner.get_process_id() << '\n';
     std::string bit_rep = scanner.is_64_bit() ? "64 bit" : "32 bit";
-    std::cout << bit_rep << "\n\n";
+    std::cout << bit_rep << '\n';
+    std::cout << "Scan threads: " << scanner.get_thread_count() << '\n';
+    std::cout << "Scan window: " << scanner.get_window_size() / (1024 * 1024) << " MiB\n";
+    std::cout << "Read ahead: " << (scanner.get_read_ahead() ? "on" : "off") << '\n';
+    std::cout << "Compare kernels: " << CompareKernels::isa_name(CompareKernels::active_isa()) << "\n\n";
 
     print_help_message(scanner, {});
 }
@@ -400,6 +1285,17 @@ std::unordered_map<std::string_view, Command> construct_command_map()
                     {"b", handle_where_became },
                     {"changed", handle_where_changed },
                     {"c", handle_where_changed },
+                    {"increased", handle_where_increased },
+                    {"+", handle_where_increased },
+                    {"decreased", handle_where_decreased },
+                    {"-", handle_where_decreased },
+                    {"unchanged", handle_where_unchanged },
+                    {"=", handle_where_unchanged },
+
+                    {"struct", handle_struct },
+                    {"aob", handle_aob },
+
+                    {"track", handle_track },
 
                     {"scan", handle_scan},
                     {"s", handle_scan},
@@ -407,48 +1303,351 @@ std::unordered_map<std::string_view, Command> construct_command_map()
                     {"pointers", handle_pointer_scan},
                     {"p", handle_pointer_scan},
 
+                    {"paths", handle_pointer_path_scan},
+                    {"pp", handle_pointer_path_scan},
+
+                    {"snapshot", handle_snapshot},
+
+                    {"limit", handle_limit},
+                    {"more", handle_more},
+                    {"dump", handle_dump},
+
+                    {"stats", handle_stats},
+
                     {"help", print_help_message},
                     {"h", print_help_message},
             };
 }
 
-std::string prompt_window_name()
+#ifdef _WIN32
+Process open_process()
 {
     std::cout << "Enter window name:\n";
     std::string response;
     std::getline(std::cin, response);
-    return response;
+    return Process{ response };
+}
+#else
+Process open_process()
+{
+    std::cout << "Enter process id:\n";
+    std::string response;
+    std::getline(std::cin, response);
+    return Process{ lexical_cast<pid_t>(response) };
+}
+#endif
+
+std::optional<std::string_view> find_option(int argc, char** argv, std::string_view short_name, std::string_view long_name)
+{
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+        if (arg == short_name or arg == long_name)
+        {
+            return argv[i + 1];
+        }
+    }
+
+    return {};
+}
+
+// An option with only a long name.
+std::optional<std::string_view> find_option(int argc, char** argv, std::string_view long_name)
+{
+    return find_option(argc, argv, long_name, long_name);
 }
 
-int main()
+std::unique_ptr<MemorySource> open_memory_file(const std::string& path)
+{
+    if (CoreFileSource::is_elf_file(path))
+        return std::make_unique<CoreFileSource>(path);
+    return std::make_unique<SnapshotFileSource>(path);
+}
+
+// Scan control of the command being run, for the Ctrl-C handler. Null while no command runs.
+std::atomic<ScanControl*> interrupt_target = nullptr;
+
+// Ctrl-C cancels the running command, or ends the program as usual when there is none.
+extern "C" void handle_interrupt(int signal)
+{
+    if (ScanControl* control = interrupt_target.load())
+    {
+        std::signal(signal, handle_interrupt); // some platforms reset the handler once it runs.
+        control->cancel();
+        return;
+    }
+
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+// Runs command lines one at a time on a background thread, in the order they were entered, so the input loop stays free
+// to cancel the running one. A second thread shows the first matches and progress of scans that take a while.
+class CommandRunner
+{
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr auto quiet_time = std::chrono::milliseconds(250); // scans done sooner show nothing extra.
+    static constexpr auto progress_interval = std::chrono::seconds(1);
+
+    Scanner& scanner;
+    const std::unordered_map<std::string_view, Command>& commands;
+    std::optional<std::string_view> trace_prefix;
+    int traced_commands = 0;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::string> queue;
+    bool busy = false;
+    bool stopping = false;
+    std::uint64_t command_number = 0;
+    Clock::time_point command_start;
+
+    std::thread worker;
+    std::thread monitor;
+
+    void run(const std::string& line)
+    {
+        std::vector<std::string_view> args = tokenize_string(line, ' ');
+        std::string_view command = args[0];
+
+        auto command_it = commands.find(command);
+        if (command_it == commands.end())
+        {
+            std::cout << "Invalid command\n\n";
+            return;
+        }
+
+        const Command& to_run = command_it->second;
+        // stats reports on the previous command, so it is not measured itself.
+        if (command == "stats")
+        {
+            std::invoke(to_run, scanner, std::span(args).subspan(1));
+            return;
+        }
+
+        ScanStats& stats = scanner.get_stats();
+        ScanControl& control = scanner.get_control();
+        stats.begin_command(line);
+        control.begin_command();
+        interrupt_target = &control;
+        try
+        {
+            std::invoke(to_run, scanner, std::span(args).subspan(1));
+        }
+        catch (const ScanCancelled&)
+        {
+            const ScanControl::Progress progress = control.get_progress();
+            std::cout << "Cancelled";
+            if (progress.bytes_total > 0)
+            {
+                std::cout << " after " << progress.bytes_done / (1024 * 1024) << " of " << progress.bytes_total / (1024 * 1024) << " MiB";
+            }
+            std::cout << ". The where chain is as it was before the command.\n";
+        }
+        interrupt_target = nullptr;
+        stats.end_command();
+
+        if (trace_prefix)
+        {
+            std::ofstream trace_file { std::string{ *trace_prefix } + std::to_string(++traced_commands) + ".json" };
+            stats.write_trace(trace_file);
+        }
+    }
+
+    void run_queue()
+    {
+        std::unique_lock lock { mutex };
+        while (true)
+        {
+            changed.wait(lock, [&]{ return stopping or !queue.empty(); });
+            if (queue.empty())
+                return;
+
+            std::string line = std::move(queue.front());
+            queue.pop_front();
+            busy = true;
+            ++command_number;
+            command_start = Clock::now();
+            lock.unlock();
+
+            run(line);
+            std::cout.flush();
+
+            lock.lock();
+            busy = false;
+            changed.notify_all();
+        }
+    }
+
+    // Once a command has scanned for quiet_time, shows the first matches it found and then its progress every
+    // progress_interval, while a scan is under way (not while the command prints its results).
+    void watch()
+    {
+        std::uint64_t watched = 0;
+        bool hits_shown = false;
+        Clock::time_point last_progress;
+
+        std::unique_lock lock { mutex };
+        while (!stopping)
+        {
+            changed.wait_for(lock, std::chrono::milliseconds(100));
+            if (!busy or Clock::now() - command_start < quiet_time)
+                continue;
+
+            if (watched != command_number)
+            {
+                watched = command_number;
+                hits_shown = false;
+                last_progress = command_start;
+            }
+            lock.unlock();
+
+            ScanControl& control = scanner.get_control();
+            const ScanControl::Progress progress = control.get_progress();
+            if (progress.bytes_done < progress.bytes_total and !control.is_cancelled())
+            {
+                OutputBuffer out { std::cerr };
+                if (!hits_shown and progress.matches > 0)
+                {
+                    hits_shown = true;
+                    out << "First matches:";
+                    for (std::uintptr_t offset : control.get_first_hits())
+                    {
+                        out << ' ';
+                        out.hex(offset);
+                    }
+                    out << '\n';
+                }
+
+                if (Clock::now() - last_progress >= progress_interval)
+                {
+                    last_progress = Clock::now();
+                    out << "Progress: ";
+                    out.number(progress.bytes_done * 100 / progress.bytes_total) << "% (";
+                    out.number(progress.bytes_done / (1024 * 1024)) << " / ";
+                    out.number(progress.bytes_total / (1024 * 1024)) << " MiB), ";
+                    out.number(progress.matches) << " matches\n";
+                }
+            }
+
+            lock.lock();
+        }
+    }
+
+public:
+
+    CommandRunner(Scanner& scanner, const std::unordered_map<std::string_view, Command>& commands, std::optional<std::string_view> trace_prefix)
+        :   scanner(scanner), commands(commands), trace_prefix(trace_prefix)
+    {
+        worker = std::thread{ [this]{ run_queue(); } };
+        monitor = std::thread{ [this]{ watch(); } };
+    }
+
+    CommandRunner(const CommandRunner& copy) = delete;
+    CommandRunner& operator=(const CommandRunner& copy) = delete;
+
+    // Runs the commands still queued, then stops.
+    ~CommandRunner()
+    {
+        {
+            std::scoped_lock lock { mutex };
+            stopping = true;
+        }
+        changed.notify_all();
+        worker.join();
+        monitor.join();
+    }
+
+    void enqueue(std::string line)
+    {
+        {
+            std::scoped_lock lock { mutex };
+            queue.push_back(std::move(line));
+        }
+        changed.notify_all();
+    }
+
+    // Cancels the running command and drops the ones queued after it. Returns false if there was nothing to cancel.
+    bool cancel()
+    {
+        std::scoped_lock lock { mutex };
+        const bool had_work = busy or !queue.empty();
+        queue.clear();
+        if (busy)
+            scanner.get_control().cancel();
+        return had_work;
+    }
+
+    void wait_until_idle()
+    {
+        std::unique_lock lock { mutex };
+        changed.wait(lock, [&]{ return !busy and queue.empty(); });
+    }
+};
+
+int main(int argc, char** argv)
 {
-    const std::string window_name = prompt_window_name();
-    Scanner scanner { window_name };
+    auto threads_option = find_option(argc, argv, "-t", "--threads");
+    const unsigned num_threads = threads_option ? std::max(lexical_cast<unsigned>(*threads_option), 1u) : std::max(std::thread::hardware_concurrency(), 1u);
+
+    auto file_option = find_option(argc, argv, "-f", "--file");
+    // A file that cannot be opened or is corrupt ends the program with its error.
+    std::unique_ptr<MemorySource> memory;
+    try
+    {
+        memory = file_option
+            ? open_memory_file(std::string{ *file_option })
+            : std::make_unique<ProcessSource>(open_process());
+    }
+    catch (const std::runtime_error& error)
+    {
+        std::cerr << error.what() << '\n';
+        return 1;
+    }
+    Scanner scanner { std::move(memory), num_threads };
+
+    if (auto window_option = find_option(argc, argv, "-w", "--window-mb"))
+    {
+        scanner.set_window_size(lexical_cast<std::size_t>(*window_option) * 1024 * 1024);
+    }
+
+    if (auto read_ahead_option = find_option(argc, argv, "-r", "--read-ahead"))
+    {
+        scanner.set_read_ahead(*read_ahead_option == "on");
+    }
+
+    auto trace_option = find_option(argc, argv, "--trace");
+    scanner.get_stats().set_tracing(trace_option.has_value());
+
     print_intro(scanner);
 
     const auto commands = construct_command_map();
-    while (running)
-    {
-        std::string response;
-        std::getline(std::cin, response);
+    CommandRunner runner { scanner, commands, trace_option };
+    std::signal(SIGINT, handle_interrupt);
 
+    std::string response;
+    while (running and std::getline(std::cin, response))
+    {
         if (response.empty())
         {
             continue;
         }
 
-        std::vector<std::string_view> args = tokenize_string(response, ' ');
-        std::string_view command = args[0];
-
-        auto command_it = commands.find(command);
-        if (command_it != commands.end())
+        std::string_view command = tokenize_string(response, ' ')[0];
+        if (command == "cancel")
         {
-            const Command& to_run = command_it->second;
-            std::invoke(to_run, scanner, std::span(args).subspan(1));
+            if (!runner.cancel())
+            {
+                std::cout << "Nothing to cancel.\n";
+            }
+            continue;
         }
-        else
+
+        runner.enqueue(response);
+        if (command == "quit" or command == "q")
         {
-            std::cout << "Invalid command\n\n";
+            runner.wait_until_idle();
         }
     }
 
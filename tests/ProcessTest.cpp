@@ -0,0 +1,153 @@
+// Scans a forked child with known values through the Linux process backend: where finds every planted value, and
+// became keeps exactly the ones the child then changes. Exits non-zero if any check fails.
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <vector>
+#include "Scanner/Scanner.h"
+
+namespace
+{
+
+    constexpr std::int32_t planted_value = 0x3C5A7E12;
+    constexpr std::int32_t changed_value = 0x3C5A7E14;
+    constexpr std::size_t num_planted = 64;
+    constexpr std::size_t num_changed = 16;
+    constexpr std::size_t fill_words = 4 * 1024 * 1024; // 16 MiB, several scan windows.
+
+    int failures = 0;
+
+    void check(bool passed, const char* what)
+    {
+        if (!passed)
+        {
+            std::fprintf(stderr, "FAILED: %s\n", what);
+            ++failures;
+        }
+    }
+
+    bool read_all(int fd, void* buf, std::size_t size)
+    {
+        auto* dest = static_cast<char*>(buf);
+        while (size > 0)
+        {
+            const ssize_t got = read(fd, dest, size);
+            if (got <= 0)
+                return false;
+            dest += got;
+            size -= static_cast<std::size_t>(got);
+        }
+        return true;
+    }
+
+    bool write_all(int fd, const void* buf, std::size_t size)
+    {
+        return write(fd, buf, size) == static_cast<ssize_t>(size);
+    }
+
+    // Fills a heap block with odd words (planted values are even, so never matched by chance), plants the value,
+    // sends the planted addresses and changes the first num_changed of them when asked. Exits at end of input.
+    [[noreturn]] void run_child(int from_parent, int to_parent)
+    {
+        std::vector<std::int32_t> fill(fill_words);
+        std::uint32_t state = 0x2545F491;
+        for (std::int32_t& word : fill)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            word = static_cast<std::int32_t>(state | 1);
+        }
+
+        std::uintptr_t addresses[num_planted];
+        for (std::size_t i = 0; i < num_planted; ++i)
+        {
+            std::int32_t* slot = &fill[(i * 65537 + 11) % fill_words];
+            *slot = planted_value;
+            addresses[i] = reinterpret_cast<std::uintptr_t>(slot);
+        }
+        write_all(to_parent, addresses, sizeof addresses);
+
+        char command;
+        while (read(from_parent, &command, 1) == 1)
+        {
+            for (std::size_t i = 0; i < num_changed; ++i)
+                *reinterpret_cast<std::int32_t*>(addresses[i]) += changed_value - planted_value;
+            write_all(to_parent, &command, 1);
+        }
+        _exit(0);
+    }
+
+    std::vector<std::uintptr_t> relative(const Scanner& scanner, std::span<const std::uintptr_t> addresses)
+    {
+        std::vector<std::uintptr_t> offsets;
+        for (std::uintptr_t address : addresses)
+            offsets.push_back(scanner.get_relative_address(address));
+        std::sort(offsets.begin(), offsets.end());
+        return offsets;
+    }
+
+}
+
+int main()
+{
+    int to_child[2];
+    int from_child[2];
+    if (pipe(to_child) != 0 or pipe(from_child) != 0)
+    {
+        std::perror("pipe");
+        return 1;
+    }
+
+    const pid_t pid = fork();
+    if (pid < 0)
+    {
+        std::perror("fork");
+        return 1;
+    }
+    if (pid == 0)
+    {
+        close(to_child[1]);
+        close(from_child[0]);
+        run_child(to_child[0], from_child[1]);
+    }
+    close(to_child[0]);
+    close(from_child[1]);
+
+    std::uintptr_t addresses[num_planted];
+    if (!read_all(from_child[0], addresses, sizeof addresses))
+    {
+        std::fprintf(stderr, "The child did not report its values.\n");
+        return 1;
+    }
+
+    {
+        Scanner scanner { Process{ pid }, 2 };
+        const std::vector<std::uintptr_t> planted = relative(scanner, addresses);
+
+        check(scanner.read_mem<std::int32_t>(planted.front()) == planted_value, "read of a planted value");
+
+        const std::vector<std::uintptr_t> found = scanner.where_val(planted_value).to_vector();
+        check(std::includes(found.begin(), found.end(), planted.begin(), planted.end()), "where finds every planted value");
+
+        char command = 'c';
+        check(write_all(to_child[1], &command, 1) and read_all(from_child[0], &command, 1), "child changed its values");
+
+        const std::vector<std::uintptr_t> became = scanner.where_became(changed_value).to_vector();
+        check(became == relative(scanner, std::span(addresses).first(num_changed)), "became keeps exactly the changed values");
+
+        check(scanner.where_became(planted_value).empty(), "became the old value again finds nothing");
+    }
+
+    close(to_child[1]);
+    waitpid(pid, nullptr, 0);
+
+    if (failures == 0)
+        std::printf("All checks passed.\n");
+    return failures == 0 ? 0 : 1;
+}